@@ -0,0 +1,34 @@
+# Writes the ROMs and sounds found under SOURCE_DIR to OUTPUT as constant
+# arrays. Run at build time with cmake -DSOURCE_DIR=... -DOUTPUT=... -P
+file(GLOB roms RELATIVE ${SOURCE_DIR} ${SOURCE_DIR}/roms/invaders.*)
+file(GLOB sounds RELATIVE ${SOURCE_DIR} ${SOURCE_DIR}/sounds/*.wav)
+
+# CMake regexes have no {n} repeat, so build the 16 bytes per line pattern by hand
+set(line "")
+foreach(i RANGE 15)
+    set(line "${line}0x..,")
+endforeach()
+
+set(arrays "")
+set(table "")
+set(index 0)
+
+foreach(name IN LISTS roms sounds)
+    file(READ ${SOURCE_DIR}/${name} hex HEX)
+    if(NOT hex STREQUAL "")
+        string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+        string(REGEX REPLACE "(${line})" "\\1\n    " bytes "${bytes}")
+        set(arrays "${arrays}static const uint8_t asset_${index}[] = {\n    ${bytes}\n};\n\n")
+        set(table "${table}    { \"${name}\", asset_${index}, sizeof(asset_${index}) },\n")
+        math(EXPR index "${index} + 1")
+    endif()
+endforeach()
+
+file(WRITE ${OUTPUT}
+    "/* Generated by cmake/embed_assets.cmake, do not edit */\n"
+    "#include \"assets.h\"\n\n"
+    "${arrays}"
+    "const Asset embedded_assets[] = {\n"
+    "${table}"
+    "    { NULL, NULL, 0 }\n"
+    "};\n")
@@ -0,0 +1,19 @@
+#include <string.h>
+#include "assets.h"
+
+#ifdef EMBED_ASSETS
+extern const Asset embedded_assets[];
+#else
+static const Asset embedded_assets[] = {
+    { NULL, NULL, 0 }
+};
+#endif
+
+const Asset *asset_find(const char *name) {
+    for (const Asset *asset = embedded_assets; asset->name; asset++) {
+        if (strcmp(asset->name, name) == 0) {
+            return asset;
+        }
+    }
+    return NULL;
+}
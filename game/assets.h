@@ -0,0 +1,19 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct Asset {
+    const char *name;           // Path relative to the source tree, e.g. "roms/invaders.h"
+    const uint8_t *data;
+    size_t size;
+} Asset;
+
+/* Built with -DEMBED_ASSETS=ON, the ROMs and sounds are compiled into the
+ * executable and nothing has to be found on disk at startup. Otherwise
+ * every lookup misses and callers fall back to the files.
+ */
+const Asset *asset_find(const char *name);
+
+#endif
@@ -0,0 +1,237 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "callgraph.h"
+
+#define REPORT_ROUTINES 15
+#define NUM_ADDRESSES (CALLGRAPH_START + 1)
+#define NAME_BYTES 64
+
+// Reads "ADDRESS NAME" lines, with the address in hex; # starts a comment
+static bool _load_symbols(CallGraph *g, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    g->symbols = calloc(MAX_MEM, sizeof(char *));
+    if (!g->symbols) {
+        fclose(file);
+        return false;
+    }
+
+    char line[256];
+    char name[NAME_BYTES];
+    unsigned address;
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] != '#' && sscanf(line, "%x %63s", &address, name) == 2 && address < MAX_MEM) {
+            free(g->symbols[address]);
+            g->symbols[address] = strdup(name);
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+static void _name(const CallGraph *g, uint32_t address, char *out, size_t size) {
+    bool interrupt = address >= CALLGRAPH_INTERRUPT;
+    uint16_t entry = address & 0xffff;
+
+    if (address == CALLGRAPH_START) {
+        snprintf(out, size, "start");
+    } else if (g->symbols && g->symbols[entry]) {
+        snprintf(out, size, "%s%s", interrupt ? "interrupt:" : "", g->symbols[entry]);
+    } else {
+        snprintf(out, size, "%s%04x", interrupt ? "interrupt_" : "sub_", entry);
+    }
+}
+
+bool callgraph_open(CallGraph *g, const char *symbol_path) {
+    memset(g, 0, sizeof(*g));
+    g->nodes = calloc(CALLGRAPH_NODES, sizeof(CallNode));
+    if (!g->nodes || (symbol_path && !_load_symbols(g, symbol_path))) {
+        callgraph_close(g);
+        return false;
+    }
+
+    g->nodes[CALLGRAPH_ROOT].address = CALLGRAPH_START;
+    g->num_nodes = 1;
+    g->current = CALLGRAPH_ROOT;
+    return true;
+}
+
+static void _charge(CallGraph *g, unsigned long long cycles) {
+    g->nodes[g->current].self += cycles - g->mark;
+    g->mark = cycles;
+}
+
+static uint32_t _child(CallGraph *g, uint32_t parent, uint32_t address) {
+    uint32_t i;
+
+    for (i = g->nodes[parent].first_child; i; i = g->nodes[i].next_sibling) {
+        if (g->nodes[i].address == address) {
+            return i;
+        }
+    }
+    if (g->num_nodes == CALLGRAPH_NODES) {
+        return CALLGRAPH_ROOT;
+    }
+
+    i = g->num_nodes++;
+    g->nodes[i].address = address;
+    g->nodes[i].parent = parent;
+    g->nodes[i].next_sibling = g->nodes[parent].first_child;
+    g->nodes[parent].first_child = i;
+    return i;
+}
+
+// A call that is not followed needs no undoing: its return unwinds to a frame that is still there
+static void _enter(CallGraph *g, uint32_t address, bool interrupt, uint16_t sp) {
+    uint32_t node = g->depth < CALLGRAPH_DEPTH ?
+        _child(g, interrupt ? CALLGRAPH_ROOT : g->current, address) : CALLGRAPH_ROOT;
+
+    if (node == CALLGRAPH_ROOT) {
+        g->lost++;
+        return;
+    }
+
+    g->frames[g->depth].node = node;
+    g->frames[g->depth].sp = sp;
+    g->depth++;
+    g->current = node;
+}
+
+// Pops every frame the stack pointer is now above, in case the guest unwound more than one
+static void _leave(CallGraph *g, uint16_t sp) {
+    while (g->depth && g->frames[g->depth - 1].sp <= sp) {
+        g->depth--;
+    }
+    g->current = g->depth ? g->frames[g->depth - 1].node : CALLGRAPH_ROOT;
+}
+
+// Called after a branch that moved the stack pointer
+void callgraph_branch(CallGraph *g, const State8080 *state, uint8_t opcode, uint16_t pc, uint16_t sp) {
+    if (state->sp == (uint16_t)(sp - 2) && (opcode_info[opcode].kind & OP_MEM_WRITE)) {
+        // An interrupt pushes the address of the instruction it cut in front of
+        uint16_t ret = state->memory[state->sp] | (state->memory[(uint16_t)(state->sp + 1)] << 8);
+        bool interrupt = ret == pc;
+
+        _charge(g, state->cycles);
+        _enter(g, interrupt ? CALLGRAPH_INTERRUPT + state->pc : state->pc, interrupt, sp);
+    } else if (state->sp == (uint16_t)(sp + 2)) {
+        _charge(g, state->cycles);
+        _leave(g, state->sp);
+    }
+}
+
+void callgraph_finish(CallGraph *g, unsigned long long cycles) {
+    _charge(g, cycles);
+
+    // Children always come after their parents
+    for (uint32_t i = 0; i < g->num_nodes; i++) {
+        g->nodes[i].total = g->nodes[i].self;
+    }
+    for (uint32_t i = g->num_nodes - 1; i > 0; i--) {
+        g->nodes[g->nodes[i].parent].total += g->nodes[i].total;
+    }
+}
+
+// One "caller;callee;... cycles" line per path, as flamegraph.pl reads them
+bool callgraph_write_folded(CallGraph *g, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < g->num_nodes; i++) {
+        uint32_t stack[CALLGRAPH_DEPTH + 1];
+        int depth = 0;
+        char name[NAME_BYTES + 16];
+
+        if (!g->nodes[i].self) {
+            continue;
+        }
+        for (uint32_t n = i; ; n = g->nodes[n].parent) {
+            stack[depth++] = n;
+            if (n == CALLGRAPH_ROOT) {
+                break;
+            }
+        }
+        while (depth--) {
+            _name(g, g->nodes[stack[depth]].address, name, sizeof(name));
+            fprintf(file, "%s%c", name, depth ? ';' : ' ');
+        }
+        fprintf(file, "%llu\n", (unsigned long long)g->nodes[i].self);
+    }
+
+    return fclose(file) == 0;
+}
+
+static const uint64_t *sort_inclusive;
+
+static int _by_inclusive(const void *a, const void *b) {
+    uint64_t x = sort_inclusive[*(const uint32_t *)a];
+    uint64_t y = sort_inclusive[*(const uint32_t *)b];
+    return (x < y) - (x > y);
+}
+
+static void _report(CallGraph *g, uint64_t *inclusive, uint64_t *exclusive, uint32_t *order, uint64_t total) {
+    for (uint32_t i = 0; i < g->num_nodes; i++) {
+        uint32_t address = g->nodes[i].address;
+        uint32_t n = g->nodes[i].parent;
+
+        exclusive[address] += g->nodes[i].self;
+
+        // Recursion would count the same cycles again
+        while (i != CALLGRAPH_ROOT && n != CALLGRAPH_ROOT && g->nodes[n].address != address) {
+            n = g->nodes[n].parent;
+        }
+        if (i == CALLGRAPH_ROOT || g->nodes[n].address != address) {
+            inclusive[address] += g->nodes[i].total;
+        }
+    }
+
+    for (uint32_t a = 0; a < NUM_ADDRESSES; a++) {
+        order[a] = a;
+    }
+    sort_inclusive = inclusive;
+    qsort(order, NUM_ADDRESSES, sizeof(uint32_t), _by_inclusive);
+
+    printf("Call graph: %u paths, %lu calls not followed\n", g->num_nodes, g->lost);
+    printf("  routine                          inclusive      %%    exclusive      %%\n");
+    for (int i = 0; i < REPORT_ROUTINES && inclusive[order[i]]; i++) {
+        uint32_t a = order[i];
+        char name[NAME_BYTES + 16];
+
+        _name(g, a, name, sizeof(name));
+        printf("  %-30s %12llu %5.1f%% %12llu %5.1f%%\n", name,
+               (unsigned long long)inclusive[a], 100.0 * inclusive[a] / total,
+               (unsigned long long)exclusive[a], 100.0 * exclusive[a] / total);
+    }
+}
+
+void callgraph_report(CallGraph *g) {
+    uint64_t *inclusive = calloc(NUM_ADDRESSES, sizeof(uint64_t));
+    uint64_t *exclusive = calloc(NUM_ADDRESSES, sizeof(uint64_t));
+    uint32_t *order = malloc(NUM_ADDRESSES * sizeof(uint32_t));
+    uint64_t total = g->nodes[CALLGRAPH_ROOT].total;
+
+    if (inclusive && exclusive && order && total) {
+        _report(g, inclusive, exclusive, order, total);
+    }
+
+    free(inclusive);
+    free(exclusive);
+    free(order);
+}
+
+void callgraph_close(CallGraph *g) {
+    if (g->symbols) {
+        for (int i = 0; i < MAX_MEM; i++) {
+            free(g->symbols[i]);
+        }
+        free(g->symbols);
+    }
+    free(g->nodes);
+}
@@ -0,0 +1,52 @@
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "emu8080.h"
+
+#define CALLGRAPH_NODES (1 << 16)       // Distinct call paths kept, later ones stay in their caller
+#define CALLGRAPH_DEPTH 64
+#define CALLGRAPH_ROOT 0
+#define CALLGRAPH_INTERRUPT 0x10000     // Added to the address of an interrupt's entry node
+#define CALLGRAPH_START 0x10100         // Address of the root, where the CPU started
+
+typedef struct CallNode {
+    uint32_t address;                   // Routine entry, or CALLGRAPH_INTERRUPT + vector
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint64_t self;                      // Cycles spent in this routine on this path
+    uint64_t total;                     // Filled in for the report
+} CallNode;
+
+typedef struct CallFrame {
+    uint32_t node;
+    uint16_t sp;                        // Stack pointer before the call, a return brings it back
+} CallFrame;
+
+/* Follows calls, RSTs and returns to keep a shadow of the guest's call
+ * stack as a path through a call tree. Cycles are charged to the current
+ * path whenever it changes. Interrupt handlers hang off the root rather
+ * than off whatever routine they interrupted.
+ */
+typedef struct CallGraph {
+    CallNode *nodes;
+    uint32_t num_nodes;
+    CallFrame frames[CALLGRAPH_DEPTH];
+    int depth;
+    uint32_t current;
+    unsigned long long mark;            // Cycle count when the current path was entered
+    unsigned long lost;                 // Calls not followed for lack of room
+
+    char **symbols;                     // Routine names by address, NULL without a symbol file
+} CallGraph;
+
+bool callgraph_open(CallGraph *graph, const char *symbol_path);
+void callgraph_branch(CallGraph *graph, const State8080 *state, uint8_t opcode, uint16_t pc, uint16_t sp);
+void callgraph_finish(CallGraph *graph, unsigned long long cycles);
+bool callgraph_write_folded(CallGraph *graph, const char *path);
+void callgraph_report(CallGraph *graph);
+void callgraph_close(CallGraph *graph);
+
+#endif
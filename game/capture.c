@@ -0,0 +1,342 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "capture.h"
+
+#define WAV_HEADER_BYTES 44
+
+typedef struct RecordHeader {
+    uint32_t stream;
+    uint32_t length;
+} RecordHeader;
+
+static void _put_le16(uint8_t *p, uint16_t v) {
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void _put_le32(uint8_t *p, uint32_t v) {
+    _put_le16(p, v & 0xFFFF);
+    _put_le16(p + 2, v >> 16);
+}
+
+static void _write_wav_header(FILE *file, int rate, int channels, uint32_t data_bytes) {
+    uint8_t h[WAV_HEADER_BYTES];
+
+    memcpy(h, "RIFF", 4);
+    _put_le32(h + 4, data_bytes + WAV_HEADER_BYTES - 8);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    _put_le32(h + 16, 16);
+    _put_le16(h + 20, 1);                               // PCM
+    _put_le16(h + 22, channels);
+    _put_le32(h + 24, rate);
+    _put_le32(h + 28, rate * channels * sizeof(int16_t));
+    _put_le16(h + 32, channels * sizeof(int16_t));
+    _put_le16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    _put_le32(h + 40, data_bytes);
+
+    fwrite(h, sizeof(h), 1, file);
+}
+
+static void _ring_copy_in(Capture *c, size_t pos, const void *data, size_t len) {
+    size_t offset = pos & (CAPTURE_RING_SIZE - 1);
+    size_t first = CAPTURE_RING_SIZE - offset;
+
+    if (first >= len) {
+        memcpy(c->ring + offset, data, len);
+    } else {
+        memcpy(c->ring + offset, data, first);
+        memcpy(c->ring, (const uint8_t *)data + first, len - first);
+    }
+}
+
+static void _ring_copy_out(Capture *c, size_t pos, void *data, size_t len) {
+    size_t offset = pos & (CAPTURE_RING_SIZE - 1);
+    size_t first = CAPTURE_RING_SIZE - offset;
+
+    if (first >= len) {
+        memcpy(data, c->ring + offset, len);
+    } else {
+        memcpy(data, c->ring + offset, first);
+        memcpy((uint8_t *)data + first, c->ring, len - first);
+    }
+}
+
+static void _ring_write_out(Capture *c, size_t pos, size_t len, FILE *file) {
+    size_t offset = pos & (CAPTURE_RING_SIZE - 1);
+    size_t first = CAPTURE_RING_SIZE - offset;
+
+    if (first >= len) {
+        fwrite(c->ring + offset, len, 1, file);
+    } else {
+        fwrite(c->ring + offset, first, 1, file);
+        fwrite(c->ring, len - first, 1, file);
+    }
+}
+
+static size_t _push(Capture *c, size_t head, CAPTURE_STREAM stream, const void *data, size_t len) {
+    RecordHeader header = { stream, len };
+
+    _ring_copy_in(c, head, &header, sizeof(header));
+    _ring_copy_in(c, head + sizeof(header), data, len);
+    return head + sizeof(header) + len;
+}
+
+static int _writer_thread(void *data) {
+    Capture *c = data;
+
+    for (;;) {
+        size_t tail = atomic_load(&c->tail);
+        size_t head = atomic_load(&c->head);
+
+        if (tail == head) {
+            if (!atomic_load(&c->running)) {
+                break;
+            }
+            SDL_SemWaitTimeout(c->pending, 100);
+            continue;
+        }
+
+        RecordHeader header;
+        _ring_copy_out(c, tail, &header, sizeof(header));
+
+        // An empty video record stands for a dropped frame, shown as the one before it
+        if (header.stream == CAPTURE_VIDEO && header.length) {
+            _ring_copy_out(c, tail + sizeof(header), c->last_frame, header.length);
+            fwrite(c->last_frame, header.length, 1, c->video);
+        } else if (header.stream == CAPTURE_VIDEO) {
+            fwrite(c->last_frame, c->frame_bytes, 1, c->video);
+        } else if (c->audio) {
+            _ring_write_out(c, tail + sizeof(header), header.length, c->audio);
+        }
+
+        atomic_store(&c->tail, tail + sizeof(header) + header.length);
+    }
+
+    return 0;
+}
+
+// The capture keeps its own voices, mixed in emulated rather than device time
+static void _sound_hook(void *userdata, MixerCommand cmd) {
+    Capture *c = userdata;
+
+    // Held until the frame is mixed so each event lands on its own sample
+    if (c->num_events < CAPTURE_EVENTS) {
+        c->events[c->num_events++] = cmd;
+    } else {
+        mixer_apply(c->voices, &c->num_voices, cmd);
+    }
+}
+
+// Mixes one frame of audio, starting each event at the sample its cycle falls on
+static void _mix_frame(Capture *c, int frames, uint64_t cycle) {
+    uint64_t span = cycle - c->frame_cycle;
+    int done = 0;
+
+    for (int i = 0; i < c->num_events; i++) {
+        MixerCommand cmd = c->events[i];
+        int offset = span ? (int)((cmd.cycle - c->frame_cycle) * frames / span) : 0;
+
+        if (offset > done) {
+            offset = offset > frames ? frames : offset;
+            mixer_mix(c->voices, &c->num_voices, c->mix + done * c->channels, offset - done);
+            done = offset;
+        }
+        mixer_apply(c->voices, &c->num_voices, cmd);
+    }
+    mixer_mix(c->voices, &c->num_voices, c->mix + done * c->channels, frames - done);
+
+    c->num_events = 0;
+    c->frame_cycle = cycle;
+}
+
+// BT.601 studio range, which is what Y4M consumers assume
+static void _rgb_to_yuv(uint32_t rgb, uint8_t *y, uint8_t *u, uint8_t *v) {
+    int r = (rgb >> 16) & 0xFF;
+    int g = (rgb >> 8) & 0xFF;
+    int b = rgb & 0xFF;
+
+    *y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+    *u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+    *v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+static void _encode_frame(Capture *c) {
+    const int plane = DISP_WIDTH * DISP_HEIGHT;
+
+    if (c->raw_rgb) {
+        uint8_t *out = c->frame;
+        for (int i = 0; i < plane; i++) {
+            *out++ = (c->pixels[i] >> 16) & 0xFF;
+            *out++ = (c->pixels[i] >> 8) & 0xFF;
+            *out++ = c->pixels[i] & 0xFF;
+        }
+        return;
+    }
+
+    uint8_t *y = c->frame + strlen("FRAME\n");
+    uint8_t *u = y + plane;
+    uint8_t *v = u + plane;
+    for (int i = 0; i < plane; i++) {
+        _rgb_to_yuv(c->pixels[i], &y[i], &u[i], &v[i]);
+    }
+}
+
+static bool _ends_with(const char *str, const char *suffix) {
+    size_t len = strlen(str);
+    size_t suffix_len = strlen(suffix);
+    return len >= suffix_len && strcmp(str + len - suffix_len, suffix) == 0;
+}
+
+bool capture_open(Capture *c, const char *path, bool lossless) {
+    memset(c, 0, sizeof(*c));
+    c->lossless = lossless;
+
+    /* The stream takes over stdout's descriptor, and stdout is pointed at
+     * stderr so reports printed at exit stay out of the stream */
+    bool to_stdout = strcmp(path, "-") == 0;
+    if (to_stdout) {
+        int fd = dup(STDOUT_FILENO);
+        c->video = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        if (!c->video) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            return false;
+        }
+        fflush(stdout);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    } else {
+        c->video = fopen(path, "wb");
+    }
+    if (!c->video) {
+        return false;
+    }
+
+    c->raw_rgb = _ends_with(path, ".rgb");
+    if (c->raw_rgb) {
+        c->frame_bytes = DISP_WIDTH * DISP_HEIGHT * 3;
+    } else {
+        c->frame_bytes = strlen("FRAME\n") + DISP_WIDTH * DISP_HEIGHT * 3;
+        fprintf(c->video, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C444\n", DISP_WIDTH, DISP_HEIGHT, REFRESH_RATE);
+    }
+
+    audio_spec(&c->rate, &c->channels);
+
+    // A pipe on stdout has nowhere to put a second stream
+    if (!to_stdout) {
+        char *audio_path = malloc(strlen(path) + strlen(".wav") + 1);
+        if (audio_path) {
+            sprintf(audio_path, "%s.wav", path);
+            c->audio = fopen(audio_path, "wb");
+            free(audio_path);
+        }
+        if (c->audio) {
+            // Sizes are patched on close when the file is seekable
+            _write_wav_header(c->audio, c->rate, c->channels, UINT32_MAX - WAV_HEADER_BYTES);
+        }
+    }
+
+    c->ring = malloc(CAPTURE_RING_SIZE);
+    c->frame = malloc(c->frame_bytes);
+    c->last_frame = malloc(c->frame_bytes);
+    c->mix = malloc((c->rate / REFRESH_RATE + 1) * c->channels * sizeof(int16_t));
+    c->pending = SDL_CreateSemaphore(0);
+    if (!c->ring || !c->frame || !c->last_frame || !c->mix || !c->pending) {
+        capture_close(c);
+        return false;
+    }
+    if (!c->raw_rgb) {
+        memcpy(c->frame, "FRAME\n", strlen("FRAME\n"));
+    }
+
+    // A frame dropped before any was written repeats a blank one
+    _encode_frame(c);
+    memcpy(c->last_frame, c->frame, c->frame_bytes);
+
+    atomic_init(&c->head, 0);
+    atomic_init(&c->tail, 0);
+    atomic_init(&c->running, true);
+    c->writer = SDL_CreateThread(_writer_thread, "capture", c);
+    if (!c->writer) {
+        capture_close(c);
+        return false;
+    }
+
+    audio_set_hook(_sound_hook, c);
+    return true;
+}
+
+// Called by the emulator at vblank with the finished frame and the current cycle count
+void capture_frame(Capture *c, const uint8_t *vram, uint64_t cycle) {
+    // Whole sample frames that fit in this video frame, carrying the remainder
+    int frames = (c->rate + c->rate_remainder) / REFRESH_RATE;
+    c->rate_remainder = (c->rate + c->rate_remainder) % REFRESH_RATE;
+    size_t audio_len = frames * c->channels * sizeof(int16_t);
+
+    _mix_frame(c, frames, cycle);
+
+    /* Without room for the picture, the frame is dropped and the writer
+     * repeats the previous one, so the video keeps its length. The sound is
+     * always queued, waiting for the writer if it must, as a gap would be
+     * heard. */
+    size_t head = atomic_load(&c->head);
+    size_t needed = 2 * sizeof(RecordHeader) + c->frame_bytes + audio_len;
+    bool drop = false;
+    while (CAPTURE_RING_SIZE - (head - atomic_load(&c->tail)) < needed) {
+        if (!c->lossless && !drop) {
+            drop = true;
+            needed -= c->frame_bytes;
+            continue;
+        }
+        SDL_Delay(1);
+    }
+
+    if (drop) {
+        head = _push(c, head, CAPTURE_VIDEO, c->frame, 0);
+        c->dropped++;
+    } else {
+        display_rasterize(c->pixels, vram);
+        _encode_frame(c);
+        head = _push(c, head, CAPTURE_VIDEO, c->frame, c->frame_bytes);
+    }
+    if (c->audio) {
+        head = _push(c, head, CAPTURE_AUDIO, c->mix, audio_len);
+        c->audio_bytes += audio_len;
+    }
+    atomic_store(&c->head, head);
+    c->frames++;
+
+    SDL_SemPost(c->pending);
+}
+
+void capture_close(Capture *c) {
+    audio_set_hook(NULL, NULL);
+
+    if (c->writer) {
+        atomic_store(&c->running, false);
+        SDL_SemPost(c->pending);
+        SDL_WaitThread(c->writer, NULL);
+    }
+
+    if (c->audio) {
+        if (fseek(c->audio, 0, SEEK_SET) == 0) {
+            // Longer tracks keep the streaming header's "as long as the file" size
+            uint64_t limit = UINT32_MAX - WAV_HEADER_BYTES;
+            _write_wav_header(c->audio, c->rate, c->channels, c->audio_bytes < limit ? c->audio_bytes : limit);
+        }
+        fclose(c->audio);
+    }
+    if (c->video) {
+        fclose(c->video);
+    }
+
+    if (c->pending) {
+        SDL_DestroySemaphore(c->pending);
+    }
+    free(c->ring);
+    free(c->frame);
+    free(c->last_frame);
+    free(c->mix);
+}
@@ -0,0 +1,64 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
+#include "hardware.h"
+#include "mixer.h"
+
+#define CAPTURE_RING_SIZE (1 << 24)     // Must be a power of two
+#define CAPTURE_EVENTS 64               // Sound events held back per frame
+
+typedef enum {
+    CAPTURE_VIDEO,
+    CAPTURE_AUDIO
+} CAPTURE_STREAM;
+
+/* Encodes every frame and its share of the sound track on the emulator
+ * thread, then queues the bytes in a single-producer/single-consumer ring
+ * that a writer thread drains to disk. When the writer falls behind, frames
+ * are dropped instead of stalling emulation, unless the capture is lossless
+ * (headless runs have no real time to keep up with). A dropped frame is
+ * written as a copy of the one before it, and its sound is kept.
+ */
+typedef struct Capture {
+    FILE *video;
+    FILE *audio;
+    bool raw_rgb;
+    bool lossless;              // Wait for the writer instead of dropping frames
+
+    uint8_t *ring;
+    atomic_size_t head;         // Written by the emulator
+    atomic_size_t tail;         // Written by the writer thread
+    SDL_Thread *writer;
+    SDL_sem *pending;
+    atomic_bool running;
+
+    uint32_t pixels[DISP_WIDTH * DISP_HEIGHT];
+    uint8_t *frame;
+    uint8_t *last_frame;        // Owned by the writer, repeated for dropped frames
+    size_t frame_bytes;
+
+    int rate;
+    int channels;
+    int rate_remainder;         // Carries the fraction of a sample frame between frames
+    int16_t *mix;
+    MixerVoice voices[MIXER_VOICES];
+    int num_voices;
+    MixerCommand events[CAPTURE_EVENTS];
+    int num_events;
+    uint64_t frame_cycle;       // CPU cycle the current frame started on
+    uint64_t audio_bytes;       // Can pass 4 GiB, which WAV sizes cannot
+
+    unsigned long frames;
+    unsigned long dropped;
+} Capture;
+
+bool capture_open(Capture *capture, const char *path, bool lossless);
+void capture_frame(Capture *capture, const uint8_t *vram, uint64_t cycle);
+void capture_close(Capture *capture);
+
+#endif
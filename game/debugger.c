@@ -0,0 +1,472 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include "debugger.h"
+
+enum { COND_EQ, COND_NE, COND_LT, COND_LE, COND_GT, COND_GE, NUM_CONDS };
+
+static const char *const cond_ops[NUM_CONDS] = { "==", "!=", "<", "<=", ">", ">=" };
+
+// Registers first, then pairs, then flags, as conditions name them
+static const char *const reg_names[] = {
+    "b", "c", "d", "e", "h", "l", "a", "bc", "de", "hl", "sp", "pc", "z", "s", "p", "cy", "ac"
+};
+#define NUM_REG_NAMES (int)(sizeof(reg_names) / sizeof(reg_names[0]))
+
+static const char *const access_names[] = { "", "read", "write", "read and write" };
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void _on_interrupt(int signal) {
+    interrupted = 1;
+}
+
+bool debugger_open(Debugger *d, bool stop_at_start) {
+    memset(d, 0, sizeof(*d));
+    d->next_id = 1;
+    d->stop = stop_at_start;
+
+    // Replaces SDL's handler, which would quit instead
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = _on_interrupt;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGINT, &action, NULL) == 0;
+}
+
+void debugger_close(Debugger *d) {
+    signal(SIGINT, SIG_DFL);
+}
+
+// Whether the next half frame has to run on the debug loop
+bool debugger_active(const Debugger *d) {
+    return d->stop || interrupted || d->mode != DEBUG_RUN || d->num_breaks || d->num_watches;
+}
+
+static unsigned _reg_value(const State8080 *s, int reg) {
+    switch (reg) {
+        case 7: return s->registers[B] << 8 | s->registers[C];
+        case 8: return s->registers[D] << 8 | s->registers[E];
+        case 9: return s->registers[H] << 8 | s->registers[L];
+        case 10: return s->sp;
+        case 11: return s->pc;
+        case 12: return s->cc.z;
+        case 13: return s->cc.s;
+        case 14: return s->cc.p;
+        case 15: return s->cc.cy;
+        case 16: return s->cc.ac;
+        default: return s->registers[reg];
+    }
+}
+
+static bool _holds(const DebugCondition *c, const State8080 *s) {
+    if (c->reg < 0) {
+        return true;
+    }
+
+    unsigned value = _reg_value(s, c->reg);
+    switch (c->op) {
+        case COND_EQ: return value == c->value;
+        case COND_NE: return value != c->value;
+        case COND_LT: return value < c->value;
+        case COND_LE: return value <= c->value;
+        case COND_GT: return value > c->value;
+        default: return value >= c->value;
+    }
+}
+
+static void _print_state(const State8080 *s) {
+    printf("A: %02x, BC: %04x, DE: %04x, HL: %04x, pc: %04x, sp: %04x, z=%d s=%d p=%d cy=%d ac=%d, cycle %llu\n",
+           s->registers[A], _reg_value(s, 7), _reg_value(s, 8), _reg_value(s, 9), s->pc, s->sp,
+           s->cc.z, s->cc.s, s->cc.p, s->cc.cy, s->cc.ac, s->cycles);
+    if (s->interrupt >= 0 && s->int_enable) {
+        printf("     interrupt pending: RST %d\n", (s->interrupt >> 3) & 7);
+    }
+    Disassemble8080Op((unsigned char *)s->memory, s->pc);
+}
+
+/* The bytes an instruction is about to access, worked out from its opcode
+ * and the registers before it runs. Returns how many there are. */
+static int _access(const State8080 *s, uint8_t opcode, uint16_t *address) {
+    unsigned kind = opcode_info[opcode].kind;
+    uint16_t operand = s->memory[(uint16_t)(s->pc + 1)] | s->memory[(uint16_t)(s->pc + 2)] << 8;
+    bool m_operand = (opcode >= 0x40 && opcode < 0xc0 && ((opcode & 0x07) == 6 || (opcode & 0xf8) == 0x70)) ||
+                     (opcode >= 0x34 && opcode <= 0x36);
+
+    if (!(kind & (OP_MEM_READ | OP_MEM_WRITE))) {
+        return 0;
+    }
+
+    switch (opcode) {
+        case 0x02: case 0x0a: *address = _reg_value(s, 7); return 1;
+        case 0x12: case 0x1a: *address = _reg_value(s, 8); return 1;
+        case 0x22: case 0x2a: *address = operand; return 2;
+        case 0x32: case 0x3a: *address = operand; return 1;
+    }
+    if (m_operand) {
+        *address = _reg_value(s, 9);
+        return 1;
+    }
+
+    // Everything else goes through the stack, pushes below sp and pops at it
+    *address = (kind & OP_MEM_READ) ? s->sp : s->sp - 2;
+    return 2;
+}
+
+static Watchpoint *_watch_hit(Debugger *d, uint16_t address, int length, unsigned access) {
+    for (int i = 0; i < d->num_watches; i++) {
+        Watchpoint *w = &d->watches[i];
+        bool overlaps = (uint16_t)(address - w->address) < w->length || (uint16_t)(w->address - address) < length;
+        if ((w->access & access) && overlaps) {
+            return w;
+        }
+    }
+    return NULL;
+}
+
+static bool _parse_hex(const char *text, unsigned *value) {
+    char *end;
+    if (!text) {
+        return false;
+    }
+    *value = strtoul(text, &end, 16);
+    return *text && !*end && *value <= 0xffff;
+}
+
+static void _add_break(Debugger *d, char *args) {
+    char *address = strtok(args, " \t");
+    char *keyword = strtok(NULL, " \t");
+    unsigned value;
+    Breakpoint b = { .id = d->next_id, .when = { .reg = -1 } };
+
+    if (!_parse_hex(address, &value) || d->num_breaks == DEBUG_BREAKPOINTS) {
+        printf("Usage: b ADDR [if REG OP VALUE], at most %d breakpoints\n", DEBUG_BREAKPOINTS);
+        return;
+    }
+    b.address = value;
+
+    if (keyword) {
+        char *reg = strtok(NULL, " \t");
+        char *op = strtok(NULL, " \t");
+        char *operand = strtok(NULL, " \t");
+
+        b.when.op = -1;
+        for (int i = 0; reg && i < NUM_REG_NAMES; i++) {
+            b.when.reg = strcmp(reg, reg_names[i]) == 0 ? i : b.when.reg;
+        }
+        for (int i = 0; op && i < NUM_CONDS; i++) {
+            b.when.op = strcmp(op, cond_ops[i]) == 0 ? i : b.when.op;
+        }
+        if (strcmp(keyword, "if") != 0 || b.when.reg < 0 || b.when.op < 0 || !_parse_hex(operand, &b.when.value)) {
+            printf("Conditions are REG OP VALUE, REG one of a b c d e h l bc de hl sp pc z s p cy ac,\n"
+                   "OP one of == != < <= > >= and VALUE in hex\n");
+            return;
+        }
+    }
+
+    d->breaks[d->num_breaks++] = b;
+    printf("Breakpoint %d at %04x\n", d->next_id++, b.address);
+}
+
+static void _add_watch(Debugger *d, char *args) {
+    char *address = strtok(args, " \t");
+    char *arg;
+    unsigned value;
+    Watchpoint w = { .id = d->next_id, .length = 1, .access = DEBUG_READ | DEBUG_WRITE };
+
+    if (!_parse_hex(address, &value) || d->num_watches == DEBUG_WATCHPOINTS) {
+        printf("Usage: w ADDR [LEN] [r|w|rw], at most %d watchpoints\n", DEBUG_WATCHPOINTS);
+        return;
+    }
+    w.address = value;
+
+    while ((arg = strtok(NULL, " \t"))) {
+        if (strcmp(arg, "r") == 0 || strcmp(arg, "w") == 0 || strcmp(arg, "rw") == 0) {
+            w.access = (strchr(arg, 'r') ? DEBUG_READ : 0) | (strchr(arg, 'w') ? DEBUG_WRITE : 0);
+        } else if (!_parse_hex(arg, &value) || !value) {
+            printf("Invalid length: %s\n", arg);
+            return;
+        } else {
+            w.length = value;
+        }
+    }
+
+    d->watches[d->num_watches++] = w;
+    printf("Watchpoint %d on %04x-%04x\n", d->next_id++, w.address, (uint16_t)(w.address + w.length - 1));
+}
+
+static void _delete(Debugger *d, const char *args) {
+    int id = atoi(args);
+
+    for (int i = 0; i < d->num_breaks; i++) {
+        if (d->breaks[i].id == id) {
+            d->breaks[i] = d->breaks[--d->num_breaks];
+            return;
+        }
+    }
+    for (int i = 0; i < d->num_watches; i++) {
+        if (d->watches[i].id == id) {
+            d->watches[i] = d->watches[--d->num_watches];
+            return;
+        }
+    }
+    printf("No breakpoint or watchpoint %s\n", args);
+}
+
+static void _list(const Debugger *d) {
+    for (int i = 0; i < d->num_breaks; i++) {
+        const Breakpoint *b = &d->breaks[i];
+        printf("%3d  break %04x", b->id, b->address);
+        if (b->when.reg >= 0) {
+            printf(" if %s %s %x", reg_names[b->when.reg], cond_ops[b->when.op], b->when.value);
+        }
+        printf(", hit %lu times\n", b->hits);
+    }
+    for (int i = 0; i < d->num_watches; i++) {
+        const Watchpoint *w = &d->watches[i];
+        printf("%3d  watch %04x-%04x %s%s, hit %lu times\n", w->id, w->address, (uint16_t)(w->address + w->length - 1),
+               (w->access & DEBUG_READ) ? "r" : "", (w->access & DEBUG_WRITE) ? "w" : "", w->hits);
+    }
+}
+
+static void _dump(const State8080 *s, char *args) {
+    char *address = strtok(args, " \t");
+    char *count = strtok(NULL, " \t");
+    unsigned first = 0;
+    unsigned bytes = count ? atoi(count) : 64;
+
+    if (!_parse_hex(address, &first)) {
+        printf("Usage: x ADDR [COUNT]\n");
+        return;
+    }
+    for (unsigned i = 0; i < bytes; i++) {
+        uint16_t a = first + i;
+        if (i % 16 == 0) {
+            printf("%s%04x:", i ? "\n" : "", a);
+        }
+        printf(" %02x", s->memory[a]);
+    }
+    printf("\n");
+}
+
+static void _list_code(const State8080 *s, char *args) {
+    char *address = strtok(args, " \t");
+    char *count = strtok(NULL, " \t");
+    unsigned pc = s->pc;
+    int lines = count ? atoi(count) : 8;
+
+    if (address && !_parse_hex(address, &pc)) {
+        printf("Usage: l [ADDR [COUNT]]\n");
+        return;
+    }
+    for (int i = 0; i < lines && pc < MAX_MEM - 2; i++) {
+        pc += Disassemble8080Op((unsigned char *)s->memory, pc);
+    }
+}
+
+static const char help[] =
+    "c                      continue\n"
+    "s [N]                  step N instructions\n"
+    "n                      step over a call\n"
+    "f                      finish the current routine\n"
+    "b ADDR [if REG OP VAL] break at ADDR, only when the condition holds if given\n"
+    "w ADDR [LEN] [r|w|rw]  stop after an access to LEN bytes at ADDR\n"
+    "d ID                   delete a breakpoint or watchpoint\n"
+    "i                      list breakpoints and watchpoints\n"
+    "r                      show the registers\n"
+    "x ADDR [N]             dump N bytes of memory\n"
+    "l [ADDR [N]]           disassemble N instructions\n"
+    "q                      quit\n"
+    "Addresses and values are in hex. An empty line repeats the last command.\n";
+
+// Reads commands until one resumes the game
+static void _prompt(Debugger *d, State8080 *s) {
+    char line[DEBUG_LINE];
+
+    _print_state(s);
+    for (;;) {
+        printf("(8080) ");
+        fflush(stdout);
+        if (!fgets(line, sizeof(line), stdin)) {
+            // Ctrl-C at the prompt only interrupts the read
+            if (ferror(stdin) && (errno == EINTR || interrupted)) {
+                clearerr(stdin);
+                interrupted = 0;
+                printf("\n");
+                continue;
+            }
+
+            // Out of commands, let the game run on undisturbed
+            printf("\n");
+            d->num_breaks = d->num_watches = 0;
+            d->mode = DEBUG_RUN;
+            return;
+        }
+
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[0]) {
+            strcpy(line, d->last);
+        }
+        strcpy(d->last, line);
+
+        char *args = line + strcspn(line, " \t");
+        char command = line[0];
+        if (*args) {
+            *args++ = '\0';
+        }
+        if (strlen(line) > 1) {
+            command = '?';
+        }
+
+        switch (command) {
+            case 'c':
+                d->mode = DEBUG_RUN;
+                return;
+            case 's':
+                d->mode = DEBUG_STEP;
+                d->steps = *args ? strtoul(args, NULL, 10) : 1;
+                d->steps = d->steps ? d->steps : 1;
+                return;
+            case 'n': {
+                uint8_t opcode = NextOpcode8080(s);
+                unsigned kind = opcode_info[opcode].kind;
+                bool interrupt = s->interrupt >= 0 && s->int_enable;
+
+                // Calls push, other branches do not
+                if ((kind & OP_BRANCH) && (kind & OP_MEM_WRITE)) {
+                    d->mode = DEBUG_OVER;
+                    d->target_pc = interrupt ? s->pc : s->pc + opcode_info[opcode].size;
+                    d->target_sp = s->sp;
+                } else {
+                    d->mode = DEBUG_STEP;
+                    d->steps = 1;
+                }
+                return;
+            }
+            case 'f':
+                d->mode = DEBUG_OUT;
+                d->target_sp = s->sp;
+                return;
+            case 'b':
+                _add_break(d, args);
+                break;
+            case 'w':
+                _add_watch(d, args);
+                break;
+            case 'd':
+                _delete(d, args);
+                break;
+            case 'i':
+                _list(d);
+                break;
+            case 'r':
+                _print_state(s);
+                break;
+            case 'x':
+                _dump(s, args);
+                break;
+            case 'l':
+                _list_code(s, args);
+                break;
+            case 'q':
+                s->exit = true;
+                return;
+            default:
+                printf("%s", help);
+        }
+    }
+}
+
+// Whether to stop before the instruction at pc, and why
+static bool _stop_here(Debugger *d, const State8080 *s) {
+    if (d->stop || interrupted) {
+        if (interrupted) {
+            printf("Interrupted\n");
+        }
+        d->stop = false;
+        interrupted = 0;
+        return true;
+    }
+
+    switch (d->mode) {
+        case DEBUG_STEP:
+            if (--d->steps == 0) {
+                return true;
+            }
+            break;
+        case DEBUG_OVER:
+            if (s->pc == d->target_pc && s->sp == d->target_sp) {
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    for (int i = 0; i < d->num_breaks; i++) {
+        Breakpoint *b = &d->breaks[i];
+        if (b->address == s->pc && _holds(&b->when, s)) {
+            b->hits++;
+            printf("Hit breakpoint %d at %04x\n", b->id, b->address);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* The debug copy of the frame loop's _run_until. The instruction a stop was
+ * made at runs as soon as the prompt returns, so it never stops twice. Each
+ * instruction runs through step if one is given. */
+unsigned long debugger_run_until(Debugger *d, State8080 *s, unsigned long cycles,
+                                 debug_step step, void *userdata) {
+    unsigned long count = 0;
+
+    for (; s->total_cycles < cycles && !s->exit; count++) {
+        if (_stop_here(d, s)) {
+            d->mode = DEBUG_RUN;
+            _prompt(d, s);
+            if (s->exit) {
+                break;
+            }
+        }
+
+        uint8_t opcode = NextOpcode8080(s);
+        uint16_t pc = s->pc;
+        uint16_t sp = s->sp;
+        uint16_t address = 0;
+        int length = d->num_watches ? _access(s, opcode, &address) : 0;
+
+        if (step) {
+            step(userdata, s);
+        } else {
+            Emulate8080Op(s);
+        }
+
+        // Only a taken return leaves the routine, a POP above the frame does not
+        unsigned kind = opcode_info[opcode].kind;
+        bool returned = (kind & OP_BRANCH) && (kind & OP_MEM_READ) && s->sp != sp;
+        if (d->mode == DEBUG_OUT && returned && s->sp > d->target_sp) {
+            d->stop = true;
+        }
+
+        // Untaken conditional calls and returns leave the stack alone
+        if (length && (kind & OP_CONDITIONAL) && s->sp == sp) {
+            length = 0;
+        }
+        if (length) {
+            unsigned access = ((kind & OP_MEM_READ) ? DEBUG_READ : 0) | ((kind & OP_MEM_WRITE) ? DEBUG_WRITE : 0);
+            Watchpoint *w = _watch_hit(d, address, length, access);
+
+            if (w) {
+                w->hits++;
+                d->stop = true;
+                printf("Watchpoint %d: %s of %04x by the instruction at %04x\n", w->id,
+                       access_names[access & w->access], address, pc);
+            }
+        }
+    }
+
+    return count;
+}
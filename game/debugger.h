@@ -0,0 +1,75 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "emu8080.h"
+
+#define DEBUG_BREAKPOINTS 32
+#define DEBUG_WATCHPOINTS 16
+#define DEBUG_LINE 128
+
+typedef enum {
+    DEBUG_READ = 1,
+    DEBUG_WRITE = (1 << 1)
+} DEBUG_ACCESS;
+
+typedef enum {
+    DEBUG_RUN,                          // Until a breakpoint, watchpoint or Ctrl-C
+    DEBUG_STEP,                         // A number of instructions
+    DEBUG_OVER,                         // Until the instruction after a call returns
+    DEBUG_OUT                           // Until the current routine returns
+} DEBUG_MODE;
+
+// Compares a register, register pair or flag with a value
+typedef struct DebugCondition {
+    int reg;                            // -1 when there is no condition
+    int op;
+    unsigned value;
+} DebugCondition;
+
+typedef struct Breakpoint {
+    int id;
+    uint16_t address;
+    DebugCondition when;
+    unsigned long hits;
+} Breakpoint;
+
+typedef struct Watchpoint {
+    int id;
+    uint16_t address;
+    uint16_t length;
+    unsigned access;                    // DEBUG_ACCESS bits
+    unsigned long hits;
+} Watchpoint;
+
+/* An interactive debugger on stdin and stdout. It has its own copy of the run
+ * loop, which the frame loop switches to for whole half frames while anything
+ * is set or a stop is pending. The production loop carries no checks of its
+ * own. Ctrl-C stops the game at the start of the next half frame.
+ */
+typedef struct Debugger {
+    Breakpoint breaks[DEBUG_BREAKPOINTS];
+    Watchpoint watches[DEBUG_WATCHPOINTS];
+    int num_breaks;
+    int num_watches;
+    int next_id;
+
+    DEBUG_MODE mode;
+    unsigned long steps;                // Left to run in DEBUG_STEP
+    uint16_t target_pc;                 // Where DEBUG_OVER stops
+    uint16_t target_sp;                 // The frame DEBUG_OVER and DEBUG_OUT wait for
+    bool stop;                          // Stop before the next instruction
+    char last[DEBUG_LINE];              // Repeated by an empty line
+} Debugger;
+
+// Runs one instruction, for loops that watch each one as it goes
+typedef void (*debug_step)(void *userdata, State8080 *state);
+
+bool debugger_open(Debugger *debugger, bool stop_at_start);
+bool debugger_active(const Debugger *debugger);
+unsigned long debugger_run_until(Debugger *debugger, State8080 *state, unsigned long cycles,
+                                 debug_step step, void *userdata);
+void debugger_close(Debugger *debugger);
+
+#endif
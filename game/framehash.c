@@ -0,0 +1,140 @@
+#include <string.h>
+#include "framehash.h"
+
+/* XXH64. The input is consumed in 32 byte stripes by four independent
+ * accumulators, which keeps the multiply units busy and lets the compiler
+ * vectorize the main loop.
+ */
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static uint64_t _rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t _read64(const uint8_t *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+static uint32_t _read32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t _round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = _rotl(acc, 31);
+    return acc * PRIME64_1;
+}
+
+static uint64_t _merge_round(uint64_t acc, uint64_t val) {
+    acc ^= _round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed) {
+    const uint8_t *p = data;
+    const uint8_t *end = p + len;
+    uint64_t h;
+
+    if (len >= 32) {
+        uint64_t v[4] = {
+            seed + PRIME64_1 + PRIME64_2,
+            seed + PRIME64_2,
+            seed,
+            seed - PRIME64_1
+        };
+
+        for (; p + 32 <= end; p += 32) {
+            for (int lane = 0; lane < 4; lane++) {
+                v[lane] = _round(v[lane], _read64(p + lane * 8));
+            }
+        }
+
+        h = _rotl(v[0], 1) + _rotl(v[1], 7) + _rotl(v[2], 12) + _rotl(v[3], 18);
+        for (int lane = 0; lane < 4; lane++) {
+            h = _merge_round(h, v[lane]);
+        }
+    } else {
+        h = seed + PRIME64_5;
+    }
+
+    h += len;
+
+    for (; p + 8 <= end; p += 8) {
+        h ^= _round(0, _read64(p));
+        h = _rotl(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= _read32(p) * PRIME64_1;
+        h = _rotl(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * PRIME64_5;
+        h = _rotl(h, 11) * PRIME64_1;
+    }
+
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static void _put_le(uint8_t *p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (v >> (8 * i)) & 0xFF;
+    }
+}
+
+static uint64_t _get_le(const uint8_t *p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        v = (v << 8) | p[i];
+    }
+    return v;
+}
+
+FILE *hashlog_create(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (file) {
+        fwrite(HASHLOG_MAGIC, HASHLOG_MAGIC_BYTES, 1, file);
+    }
+    return file;
+}
+
+// Checks the header of a log opened for reading
+bool hashlog_open(FILE *file) {
+    char magic[HASHLOG_MAGIC_BYTES];
+    return fread(magic, sizeof(magic), 1, file) == 1
+        && memcmp(magic, HASHLOG_MAGIC, HASHLOG_MAGIC_BYTES) == 0;
+}
+
+void hashlog_write(FILE *file, const FrameHash *record) {
+    uint8_t buf[HASHLOG_RECORD_BYTES];
+
+    _put_le(buf, record->frame, 4);
+    _put_le(buf + 4, record->vram, 8);
+    _put_le(buf + 12, record->ram, 8);
+    fwrite(buf, sizeof(buf), 1, file);
+}
+
+bool hashlog_read(FILE *file, FrameHash *record) {
+    uint8_t buf[HASHLOG_RECORD_BYTES];
+
+    if (fread(buf, sizeof(buf), 1, file) != 1) {
+        return false;
+    }
+    record->frame = _get_le(buf, 4);
+    record->vram = _get_le(buf + 4, 8);
+    record->ram = _get_le(buf + 12, 8);
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef FRAMEHASH_H
+#define FRAMEHASH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define HASHLOG_MAGIC "SIHASH01"
+#define HASHLOG_MAGIC_BYTES 8
+#define HASHLOG_RECORD_BYTES 20     // frame:u32, vram:u64, ram:u64, little endian
+
+typedef struct FrameHash {
+    uint32_t frame;
+    uint64_t vram;
+    uint64_t ram;
+} FrameHash;
+
+uint64_t hash64(const void *data, size_t len, uint64_t seed);
+
+FILE *hashlog_create(const char *path);
+bool hashlog_open(FILE *file);
+void hashlog_write(FILE *file, const FrameHash *record);
+bool hashlog_read(FILE *file, FrameHash *record);
+
+#endif
@@ -1,7 +1,7 @@
-#include <SDL2/SDL_mixer.h>
+#include <stdatomic.h>
 #include "hardware.h"
-
-#define NUM_SOUNDS 10
+#include "mixer.h"
+#include "assets.h"
 
 static SDL_Event e;
 
@@ -31,9 +31,11 @@ typedef enum {
     UFO_HIT = (1 << 4)
 } PORT_BITS;
 
-/* Registers for the IO ports to work with */
-static uint8_t inp1_reg = 0;
-static uint8_t inp2_reg = 0;
+/* Registers for the IO ports to work with, the inputs are written by the
+ * event watch on whichever thread queues the event */
+static _Atomic uint8_t inp1_reg = 0;
+static _Atomic uint8_t inp2_reg = 0;
+static atomic_uint input_stamp = 0;
 static uint8_t snd1_reg = 0;
 static uint8_t snd2_reg = 0;
 static uint16_t shift_reg = 0;
@@ -52,11 +54,41 @@ typedef enum {
     EXTRA_LIFE_SND
 } SOUND_INST;
 
-/* Sound instances */
-static Mix_Chunk *sounds[NUM_SOUNDS];
+/* Sounds that loaded successfully, set by the loader thread once a sound can play */
+static atomic_bool loaded[NUM_SOUNDS];
+static SDL_Thread *loader = NULL;
+
+static bool muted = false;
+
+// Frames emulated ahead of time are discarded, so they make no sound
+static bool speculative = false;
+
+// Speed and overlay key presses not yet picked up by the frame loop
+static atomic_int speed_presses = 0;
+static atomic_int hud_presses = 0;
+
+typedef struct KeyBinding {
+    SDL_Keycode key;
+    uint8_t inp1;
+    uint8_t inp2;
+} KeyBinding;
+
+static const KeyBinding bindings[] = {
+    { SDLK_RETURN, START_1P, 0 },
+    { SDLK_p, START_2P, 0 },
+    { SDLK_c, CREDIT, 0 },
+    { SDLK_t, 0, TILT },
+    { SDLK_SPACE, SHOT_1P, SHOT_2P },
+    { SDLK_RIGHT, RIGHT_1P, RIGHT_2P },
+    { SDLK_LEFT, LEFT_1P, LEFT_2P }
+};
 
-// Needed for lame audio bug
-static int ufo_move_chan = -1;
+/* Timestamps sound events, the CPU's cycle count never resets */
+static const State8080 *clock_cpu = NULL;
+
+/* Optional listener told about every sound start and stop */
+static sound_hook snd_hook = NULL;
+static void *snd_hook_data = NULL;
 
 
 static void _set_pixel(SDL_Surface *surface, int x, int y, long color) {
@@ -64,50 +96,85 @@ static void _set_pixel(SDL_Surface *surface, int x, int y, long color) {
     pixels[(y * surface->w) + x] = color;
 }
 
+// Colour of the cellophane overlay strips at unscaled screen coordinates
+static uint32_t _overlay_color(int x, int y) {
+    if (y < 32) {
+        return 0xFFFFFF;
+    } else if (y < 64) {
+        return 0xFF0000;
+    } else if (y < 184) {
+        return 0xFFFFFF;
+    } else if (y < 240) {
+        return 0x00FF00;
+    } else if (x < 16) {
+        return 0xFFFFFF;
+    } else if (x < 134) {
+        return 0x00FF00;
+    }
+    return 0xFFFFFF;
+}
+
+static void _sound(MIXER_CMD cmd, SOUND_INST snd) {
+    MixerCommand event = { clock_cpu ? clock_cpu->cycles : 0, cmd, snd };
+
+    if (speculative) {
+        return;
+    }
+    if (snd_hook) {
+        snd_hook(snd_hook_data, event);
+    }
+    if (!muted) {
+        mixer_command(cmd, snd, event.cycle);
+    }
+}
+
 uint8_t read_inp1(void) {
-    return inp1_reg;
+    return atomic_load_explicit(&inp1_reg, memory_order_relaxed);
 }
 
 uint8_t read_inp2(void) {
-    return inp2_reg;
+    return atomic_load_explicit(&inp2_reg, memory_order_relaxed);
 }
 
 void write_snd1(uint8_t port) {
-    if (port & UFO && sounds[UFO_MOVE_SND]) { // This sound keeps playing
-        ufo_move_chan = Mix_PlayChannel(-1, sounds[UFO_MOVE_SND], 0);
+    if (!(snd1_reg & UFO) && (port & UFO) && loaded[UFO_MOVE_SND]) { // This sound keeps playing
+        _sound(MIXER_LOOP, UFO_MOVE_SND);
+    }
+    if ((snd1_reg & UFO) && !(port & UFO)) {
+        _sound(MIXER_STOP, UFO_MOVE_SND);
     }
-    if (!(snd1_reg & SHOT) && (port & SHOT) && sounds[SHOOT_LASER_SND]) {
-        Mix_PlayChannel(-1, sounds[SHOOT_LASER_SND], 0);
+    if (!(snd1_reg & SHOT) && (port & SHOT) && loaded[SHOOT_LASER_SND]) {
+        _sound(MIXER_PLAY, SHOOT_LASER_SND);
     }
-    if (!(snd1_reg & PLAYER_DIE) && (port & PLAYER_DIE) && sounds[PLAYER_DEATH_SND]) {
-        Mix_PlayChannel(-1, sounds[PLAYER_DEATH_SND], 0);
+    if (!(snd1_reg & PLAYER_DIE) && (port & PLAYER_DIE) && loaded[PLAYER_DEATH_SND]) {
+        _sound(MIXER_PLAY, PLAYER_DEATH_SND);
     }
-    if (!(snd1_reg & INVADER_DIE) && (port & INVADER_DIE) && sounds[INVADER_DEATH_SND]) {
-        Mix_PlayChannel(-1, sounds[INVADER_DEATH_SND], 0);
+    if (!(snd1_reg & INVADER_DIE) && (port & INVADER_DIE) && loaded[INVADER_DEATH_SND]) {
+        _sound(MIXER_PLAY, INVADER_DEATH_SND);
     }
-    if (!(snd1_reg & EXTRA_LIFE) && (port & EXTRA_LIFE) && sounds[EXTRA_LIFE_SND]) {
-        Mix_PlayChannel(-1, sounds[EXTRA_LIFE_SND], 0);
+    if (!(snd1_reg & EXTRA_LIFE) && (port & EXTRA_LIFE) && loaded[EXTRA_LIFE_SND]) {
+        _sound(MIXER_PLAY, EXTRA_LIFE_SND);
     }
 
     snd1_reg = port;
 }
 
 void write_snd2(uint8_t port) {
-    if (!(snd2_reg & FLEET_MOVE1) && (port & FLEET_MOVE1) && sounds[FLEET1_SND]) {
-        Mix_PlayChannel(-1, sounds[FLEET1_SND], 0);
+    if (!(snd2_reg & FLEET_MOVE1) && (port & FLEET_MOVE1) && loaded[FLEET1_SND]) {
+        _sound(MIXER_PLAY, FLEET1_SND);
     }
-    if (!(snd2_reg & FLEET_MOVE2) && (port & FLEET_MOVE2) && sounds[FLEET1_SND]) {
-        Mix_PlayChannel(-1, sounds[FLEET2_SND], 0);
+    if (!(snd2_reg & FLEET_MOVE2) && (port & FLEET_MOVE2) && loaded[FLEET2_SND]) {
+        _sound(MIXER_PLAY, FLEET2_SND);
     }
-    if (!(snd2_reg & FLEET_MOVE3) && (port & FLEET_MOVE3) && sounds[FLEET3_SND]) {
-        Mix_PlayChannel(-1, sounds[FLEET3_SND], 0);
+    if (!(snd2_reg & FLEET_MOVE3) && (port & FLEET_MOVE3) && loaded[FLEET3_SND]) {
+        _sound(MIXER_PLAY, FLEET3_SND);
     }
-    if (!(snd2_reg & FLEET_MOVE4) && (port & FLEET_MOVE4) && sounds[FLEET4_SND]) {
-        Mix_PlayChannel(-1, sounds[FLEET4_SND], 0);
+    if (!(snd2_reg & FLEET_MOVE4) && (port & FLEET_MOVE4) && loaded[FLEET4_SND]) {
+        _sound(MIXER_PLAY, FLEET4_SND);
     }
-    if (!(snd2_reg & UFO_HIT) && (port & UFO_HIT) && sounds[UFO_HIT_SND]) {
-        Mix_HaltChannel(ufo_move_chan); 
-        Mix_PlayChannel(-1, sounds[UFO_HIT_SND], 0);
+    if (!(snd2_reg & UFO_HIT) && (port & UFO_HIT) && loaded[UFO_HIT_SND]) {
+        _sound(MIXER_STOP, UFO_MOVE_SND);
+        _sound(MIXER_PLAY, UFO_HIT_SND);
     }
 
     snd2_reg = port;
@@ -130,10 +197,26 @@ void write_watchdog(uint8_t data) {
 
 }
 
+void board_save(BoardState *board) {
+    board->shift = shift_reg;
+    board->shift_amnt = shift_amnt_reg;
+    board->snd1 = snd1_reg;
+    board->snd2 = snd2_reg;
+}
+
+void board_restore(const BoardState *board) {
+    shift_reg = board->shift;
+    shift_amnt_reg = board->shift_amnt;
+    snd1_reg = board->snd1;
+    snd2_reg = board->snd2;
+}
 
-void display_draw(SDL_Window *window, SDL_Surface *surface, const State8080 *state) {
-    for (int i = 0; i < DISP_BYTES; i++) {
-        uint8_t byte = state->memory[VIDEO_MEMORY_START + i];
+
+// Draws VRAM bytes [first, last) and presents only the columns they cover
+// The overlay, when there is one, goes over the game and never into VRAM
+void display_draw(SDL_Window *window, SDL_Surface *surface, const uint8_t *vram, int first, int last, const HudText *hud) {
+    for (int i = first; i < last; i++) {
+        uint8_t byte = vram[i];
 
         int y = (((DISP_HEIGHT * DISP_SCALE) - 1) - ((i % 32) * (8 * (DISP_SCALE))));
         int x = ((i / 32)) * DISP_SCALE;
@@ -145,23 +228,7 @@ void display_draw(SDL_Window *window, SDL_Surface *surface, const State8080 *sta
                 for (int xs = 0; xs < DISP_SCALE; xs++) {
                     int final_x = x + xs;
                     int final_y = tmp_y - ys;
-                    long color;
-
-                    if (final_y >= 0 && final_y < 32 * DISP_SCALE) {
-                        color = 0xFFFFFF;
-                    }else if (final_y >= 32 * DISP_SCALE && final_y < 64 * DISP_SCALE) {
-                        color = 0xFF0000;
-                    } else if (final_y >= 64 * DISP_SCALE && final_y < 184 * DISP_SCALE) {
-                        color = 0xFFFFFF;
-                    } else if (final_y >= 184 * DISP_SCALE && final_y < 240 * DISP_SCALE) {
-                        color = 0x00FF00;
-                    } else if (final_y >= 240 * DISP_SCALE && final_y < 256 * DISP_SCALE && final_x >= 0 && final_x < 16 * DISP_SCALE) {
-                        color = 0xFFFFFF;
-                    } else if (final_y >= 240 * DISP_SCALE && final_y < 256 * DISP_SCALE && final_x >= 16 * DISP_SCALE && final_x < 134 * DISP_SCALE) {
-                        color = 0x00FF00;
-                    } else if (final_y >= 240 * DISP_SCALE && final_y < 256 * DISP_SCALE && final_x >= 134 * DISP_SCALE && final_x < 224 * DISP_SCALE) {
-                        color = 0xFFFFFF;
-                    }
+                    long color = _overlay_color(final_x / DISP_SCALE, final_y / DISP_SCALE);
 
                     if (byte & (1 << k)) {
                         _set_pixel(surface, final_x, final_y, color);
@@ -173,106 +240,199 @@ void display_draw(SDL_Window *window, SDL_Surface *surface, const State8080 *sta
         }
     }
 
-    SDL_UpdateWindowSurface(window);
+    // It fits in the columns of the first half, which were just repainted
+    if (hud && first == 0) {
+        hud_draw(surface, hud);
+    }
+
+    SDL_Rect rect = {
+        .x = (first / 32) * DISP_SCALE,
+        .y = 0,
+        .w = ((last - first) / 32) * DISP_SCALE,
+        .h = DISP_HEIGHT * DISP_SCALE
+    };
+    SDL_UpdateWindowSurfaceRects(window, &rect, 1);
 }
 
-bool audio_init(void) {
-    if(Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
-        return false;
+// Unscaled opaque ARGB image of the whole screen, DISP_WIDTH pixels per row
+void display_rasterize(uint32_t *pixels, const uint8_t *vram) {
+    for (int i = 0; i < DISP_BYTES; i++) {
+        uint8_t byte = vram[i];
+        int x = i / 32;
+        int y = (DISP_HEIGHT - 1) - ((i % 32) * 8);
+
+        for (int k = 0; k < 8; k++) {
+            int final_y = y - k;
+            pixels[(final_y * DISP_WIDTH) + x] = 0xFF000000 | ((byte & (1 << k)) ? _overlay_color(x, final_y) : 0);
+        }
     }
+}
 
-    sounds[UFO_MOVE_SND] = Mix_LoadWAV("../sounds/0.wav");
-    sounds[SHOOT_LASER_SND] = Mix_LoadWAV("../sounds/1.wav");
-    sounds[PLAYER_DEATH_SND] = Mix_LoadWAV("../sounds/2.wav");
-    sounds[INVADER_DEATH_SND] = Mix_LoadWAV("../sounds/3.wav");
-    sounds[FLEET1_SND] = Mix_LoadWAV("../sounds/4.wav");
-    sounds[FLEET2_SND] = Mix_LoadWAV("../sounds/5.wav");
-    sounds[FLEET3_SND] = Mix_LoadWAV("../sounds/6.wav");
-    sounds[FLEET4_SND] = Mix_LoadWAV("../sounds/7.wav");
-    sounds[UFO_HIT_SND] = Mix_LoadWAV("../sounds/8.wav");
-    sounds[EXTRA_LIFE_SND] = Mix_LoadWAV("../sounds/9.wav");
+// Decodes every sound, embedded copies first, then the files next to the build
+static int _load_sounds(void *data) {
+    uint64_t start = SDL_GetPerformanceCounter();
+    int count = 0;
 
     for (int i = 0; i < NUM_SOUNDS; i++) {
-        if (!sounds[i]) {
+        char name[32];
+        char path[40];
+        sprintf(name, "sounds/%d.wav", i);
+        sprintf(path, "../%s", name);
+
+        const Asset *asset = asset_find(name);
+        bool ok = asset ? mixer_load_mem(i, asset->data, asset->size) : mixer_load(i, path);
+        if (!ok) {
             fprintf(stderr, "Failed to load sound effect %d\n", i);
         }
+
+        atomic_store(&loaded[i], ok);
+        count += ok;
     }
 
-    return true;
+    fprintf(stderr, "Loaded %d sounds in %.1f ms\n", count,
+            (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency());
+    return 0;
+}
+
+// Opens the audio device and preconverts every sound to its format on a
+// background thread, so the first frame does not wait for them. Sounds are
+// loaded even without a device so that captures still get a sound track.
+bool audio_init(void) {
+    bool opened = mixer_open(AUDIO_RATE, AUDIO_CHANNELS, MIXER_FRAMES);
+
+    for (int i = 0; i < NUM_SOUNDS; i++) {
+        atomic_init(&loaded[i], false);
+    }
+
+    loader = SDL_CreateThread(_load_sounds, "sounds", NULL);
+    if (!loader) {
+        _load_sounds(NULL);
+    }
+
+    return opened;
+}
+
+// Blocks until every sound has been decoded
+void audio_wait_loaded(void) {
+    if (loader) {
+        SDL_WaitThread(loader, NULL);
+        loader = NULL;
+    }
 }
 
 void audio_quit(void) {
-    Mix_Quit();
+    audio_wait_loaded();
+    mixer_close();
 }
 
-bool handle_input() {
-    while (SDL_PollEvent(&e)) {
-        SDL_Keycode keyc = e.key.keysym.sym;
+void audio_set_clock(const State8080 *cpu) {
+    clock_cpu = cpu;
+}
 
-        switch (e.type) {
-        case SDL_QUIT:
-            return false;
-            break;
-        case SDL_KEYDOWN:
-            switch (keyc) {
-            case SDLK_RETURN:
-                inp1_reg |= START_1P;
-                break;
-            case SDLK_c:
-                inp1_reg |= CREDIT;
-                break;
-            case SDLK_t:
-                inp2_reg |= TILT;
-                break;
-            case SDLK_SPACE:
-                inp1_reg |= SHOT_1P;
-                inp2_reg |= SHOT_2P;
-                break;
-            case SDLK_RIGHT:
-                inp1_reg |= RIGHT_1P;
-                inp2_reg |= RIGHT_2P;
-                break;
-            case SDLK_LEFT:
-                inp1_reg |= LEFT_1P;
-                inp2_reg |= LEFT_2P;
-                break;
-            case SDLK_p:
-                inp1_reg |= START_2P;
-                break;
-            }
+/* Off real time the samples would overlap or leave gaps at their original
+ * pitch, so the speakers are muted. The sound hook still sees every event. */
+void audio_set_speed(double speed) {
+    muted = speed != 1;
+    mixer_set_clock(muted ? 0 : CPU_CLOCK);
+    if (muted) {
+        mixer_command(MIXER_STOP_ALL, 0, 0);
+    }
+}
 
-            break;
-        case SDL_KEYUP:
-            switch (keyc) {
-            case SDLK_RETURN:
-                inp1_reg &= ~START_1P;
-                break;
-            case SDLK_c:
-                inp1_reg &= ~CREDIT;
-                break;
-            case SDLK_t:
-                inp2_reg &= ~TILT;
-                break;
-            case SDLK_SPACE:
-                inp1_reg &= ~SHOT_1P;
-                inp2_reg &= ~SHOT_2P;
-                break;
-            case SDLK_RIGHT:
-                inp1_reg &= ~RIGHT_1P;
-                inp2_reg &= ~RIGHT_2P;
-                break;
-            case SDLK_LEFT:
-                inp1_reg &= ~LEFT_1P;
-                inp2_reg &= ~LEFT_2P;
-                break;
-            case SDLK_2:
-                inp1_reg &= ~START_2P;
-                break;
-            }
+void audio_set_speculative(bool on) {
+    speculative = on;
+}
+
+void audio_set_hook(sound_hook hook, void *userdata) {
+    snd_hook = hook;
+    snd_hook_data = userdata;
+}
+
+// Output format the samples were converted to when they were loaded
+void audio_spec(int *rate, int *channels) {
+    mixer_spec(rate, channels);
+}
+
+unsigned long audio_underruns(void) {
+    return mixer_underruns();
+}
+
+unsigned audio_queue_depth(void) {
+    return mixer_queue_depth();
+}
+
+// Decoded 16-bit interleaved PCM of a sound, in the audio_spec format
+bool audio_sample(int snd, const int16_t **pcm, int *frames) {
+    return snd >= 0 && snd < NUM_SOUNDS && mixer_sample(snd, pcm, frames);
+}
+
+// Runs as each event is queued, so IN sees a button the moment it changes
+static int _input_watch(void *userdata, SDL_Event *event) {
+    if (event->type != SDL_KEYDOWN && event->type != SDL_KEYUP) {
+        return 1;
+    }
+
+    SDL_Keycode key = event->key.keysym.sym;
+    bool down = event->type == SDL_KEYDOWN;
+
+    if (down && key == SDLK_F3 && !event->key.repeat) {
+        atomic_fetch_add(&speed_presses, 1);
+    }
+    if (down && key == SDLK_F2 && !event->key.repeat) {
+        atomic_fetch_add(&hud_presses, 1);
+    }
 
-            break;
+    for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); i++) {
+        if (bindings[i].key != key) {
+            continue;
+        }
+
+        if (down) {
+            atomic_fetch_or(&inp1_reg, bindings[i].inp1);
+            atomic_fetch_or(&inp2_reg, bindings[i].inp2);
+        } else {
+            atomic_fetch_and(&inp1_reg, (uint8_t)~bindings[i].inp1);
+            atomic_fetch_and(&inp2_reg, (uint8_t)~bindings[i].inp2);
+        }
+        atomic_store(&input_stamp, event->key.timestamp);
+    }
+
+    return 1;
+}
+
+void input_init(void) {
+    SDL_AddEventWatch(_input_watch, NULL);
+}
+
+void input_quit(void) {
+    SDL_DelEventWatch(_input_watch, NULL);
+}
+
+// Collects pending events mid-frame, buttons apply as they arrive
+void input_pump(void) {
+    SDL_PumpEvents();
+}
+
+// Drains the event queue, buttons were already applied by the event watch
+bool handle_input() {
+    while (SDL_PollEvent(&e)) {
+        if (e.type == SDL_QUIT) {
+            return false;
         }
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+int input_speed_presses(void) {
+    return atomic_exchange(&speed_presses, 0);
+}
+
+int input_hud_presses(void) {
+    return atomic_exchange(&hud_presses, 0);
+}
+
+// SDL ticks of the event behind the last button change
+uint32_t input_timestamp(void) {
+    return atomic_load(&input_stamp);
+}
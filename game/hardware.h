@@ -5,6 +5,8 @@
 #include <stdbool.h>
 #include <SDL2/SDL.h>
 #include "emu8080.h"
+#include "mixer.h"
+#include "hud.h"
 
 #define DISP_WIDTH 224
 #define DISP_HEIGHT 256
@@ -15,6 +17,12 @@
 #define CPU_CLOCK 2000000
 #define VBLANK_RATE (CPU_CLOCK / REFRESH_RATE)
 #define VIDEO_MEMORY_START 0x2400
+#define RAM_START 0x2000
+#define RAM_SIZE 0x2000
+
+#define AUDIO_RATE 44100
+#define AUDIO_CHANNELS 2
+#define NUM_SOUNDS 10
 
 #define INP1 1
 #define INP2 2
@@ -35,14 +43,43 @@ void write_shift(uint8_t data);
 void write_shift_amnt(uint8_t data);
 void write_watchdog(uint8_t data);
 
+/* Board state outside the CPU, for snapshots */
+typedef struct BoardState {
+    uint16_t shift;
+    uint8_t shift_amnt;
+    uint8_t snd1;
+    uint8_t snd2;
+} BoardState;
+
+void board_save(BoardState *board);
+void board_restore(const BoardState *board);
+
 /* Display */
-void display_draw(SDL_Window *window, SDL_Surface *surface, const State8080 *cpu);
+void display_draw(SDL_Window *window, SDL_Surface *surface, const uint8_t *vram, int first, int last, const HudText *hud);
+void display_rasterize(uint32_t *pixels, const uint8_t *vram);
 
 /* Audio */
+typedef void (*sound_hook)(void *userdata, MixerCommand cmd);
+
 bool audio_init(void);
+void audio_wait_loaded(void);
 void audio_quit(void);
+void audio_set_clock(const State8080 *cpu);
+void audio_set_speed(double speed);
+void audio_set_speculative(bool speculative);
+void audio_set_hook(sound_hook hook, void *userdata);
+void audio_spec(int *rate, int *channels);
+unsigned long audio_underruns(void);
+unsigned audio_queue_depth(void);
+bool audio_sample(int sound, const int16_t **pcm, int *frames);
 
 /* Buttons */
+void input_init(void);
+void input_quit(void);
+void input_pump(void);
 bool handle_input(void);
+int input_speed_presses(void);
+int input_hud_presses(void);
+uint32_t input_timestamp(void);
 
 #endif
\ No newline at end of file
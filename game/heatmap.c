@@ -0,0 +1,177 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "heatmap.h"
+#include "hardware.h"
+
+#ifdef MEMORY_STATS
+
+enum { READS, WRITES, FETCHES, NUM_COUNTS };
+
+static const char *const region_names[] = { "rom", "ram", "stack", "vram", "mirror" };
+#define NUM_REGIONS (sizeof(region_names) / sizeof(region_names[0]))
+
+// The stack is the part of work RAM the stack pointer has reached
+static int _region(const Heatmap *h, uint32_t address) {
+    if (address < RAM_START) {
+        return 0;
+    }
+    if (address < VIDEO_MEMORY_START) {
+        return address >= h->stats->stack_low ? 2 : 1;
+    }
+    return address < RAM_START + RAM_SIZE ? 3 : 4;
+}
+
+static void _write_row(Heatmap *h, uint32_t address, const uint32_t counts[NUM_COUNTS]) {
+    fprintf(h->csv, "%ld,0x%04x,%s,%u,%u,%u\n", h->windows, address, region_names[_region(h, address)],
+            counts[READS], counts[WRITES], counts[FETCHES]);
+}
+
+static void _flush_window(Heatmap *h) {
+    MemoryStats *s = h->stats;
+
+    for (uint32_t page = 0; page < NUM_PAGES; page++) {
+        uint32_t sums[NUM_COUNTS] = { 0 };
+
+        for (uint32_t a = page << PAGE_SHIFT; a < (page + 1) << PAGE_SHIFT; a++) {
+            uint32_t counts[NUM_COUNTS] = { s->reads[a], s->writes[a], s->fetches[a] };
+
+            for (int k = 0; k < NUM_COUNTS; k++) {
+                sums[k] += counts[k];
+                h->totals[k * MAX_MEM + a] += counts[k];
+            }
+            if (h->per_byte && (counts[READS] || counts[WRITES] || counts[FETCHES])) {
+                _write_row(h, a, counts);
+            }
+        }
+        if (!h->per_byte) {
+            _write_row(h, page << PAGE_SHIFT, sums);
+        }
+    }
+
+    memset(s->reads, 0, sizeof(s->reads));
+    memset(s->writes, 0, sizeof(s->writes));
+    memset(s->fetches, 0, sizeof(s->fetches));
+    h->frames = 0;
+    h->windows++;
+}
+
+static bool _write_image(const Heatmap *h) {
+    FILE *file = fopen(h->image_path, "wb");
+    double scale[NUM_COUNTS];
+
+    if (!file) {
+        return false;
+    }
+
+    // Each channel is scaled to its own busiest byte
+    for (int k = 0; k < NUM_COUNTS; k++) {
+        uint64_t max = 0;
+        for (int a = 0; a < MAX_MEM; a++) {
+            max = h->totals[k * MAX_MEM + a] > max ? h->totals[k * MAX_MEM + a] : max;
+        }
+        scale[k] = max ? 255.0 / log2(max + 1.0) : 0;
+    }
+
+    fprintf(file, "P6\n256 %d\n255\n", NUM_PAGES);
+    for (int a = 0; a < MAX_MEM; a++) {
+        uint8_t pixel[3];
+        pixel[0] = (uint8_t)(log2(h->totals[WRITES * MAX_MEM + a] + 1.0) * scale[WRITES]);
+        pixel[1] = (uint8_t)(log2(h->totals[READS * MAX_MEM + a] + 1.0) * scale[READS]);
+        pixel[2] = (uint8_t)(log2(h->totals[FETCHES * MAX_MEM + a] + 1.0) * scale[FETCHES]);
+        fwrite(pixel, sizeof(pixel), 1, file);
+    }
+
+    return fclose(file) == 0;
+}
+
+static void _report(const Heatmap *h) {
+    uint64_t sums[NUM_REGIONS][NUM_COUNTS] = { { 0 } };
+
+    for (uint32_t a = 0; a < MAX_MEM; a++) {
+        for (int k = 0; k < NUM_COUNTS; k++) {
+            sums[_region(h, a)][k] += h->totals[k * MAX_MEM + a];
+        }
+    }
+
+    printf("Memory accesses, stack down to %04x:\n", h->stats->stack_low);
+    for (size_t r = 0; r < NUM_REGIONS; r++) {
+        printf("  %-6s %12llu reads %12llu writes %12llu fetches\n", region_names[r],
+               (unsigned long long)sums[r][READS], (unsigned long long)sums[r][WRITES],
+               (unsigned long long)sums[r][FETCHES]);
+    }
+}
+
+bool heatmap_open(Heatmap *h, const char *prefix, long window, bool per_byte) {
+    char *path = malloc(strlen(prefix) + 5);
+
+    memset(h, 0, sizeof(*h));
+    h->window = window;
+    h->per_byte = per_byte;
+    h->image_path = malloc(strlen(prefix) + 5);
+    h->stats = calloc(1, sizeof(MemoryStats));
+    h->totals = calloc(NUM_COUNTS * MAX_MEM, sizeof(uint64_t));
+    if (path) {
+        sprintf(path, "%s.csv", prefix);
+        h->csv = fopen(path, "w");
+        free(path);
+    }
+    if (!h->image_path || !h->stats || !h->totals || !h->csv) {
+        heatmap_close(h);
+        return false;
+    }
+
+    sprintf(h->image_path, "%s.ppm", prefix);
+    fprintf(h->csv, "window,address,region,reads,writes,fetches\n");
+    h->stats->stack_low = 0xffff;
+    memory_stats = h->stats;
+    return true;
+}
+
+// Run-ahead frames are thrown away, so their accesses are not counted
+void heatmap_pause(Heatmap *h, bool paused) {
+    memory_stats = paused ? NULL : h->stats;
+}
+
+void heatmap_frame(Heatmap *h) {
+    if (++h->frames == h->window) {
+        _flush_window(h);
+    }
+}
+
+void heatmap_close(Heatmap *h) {
+    memory_stats = NULL;
+
+    if (h->csv) {
+        if (h->frames) {
+            _flush_window(h);
+        }
+        fclose(h->csv);
+        _report(h);
+        if (!_write_image(h)) {
+            fprintf(stderr, "Could not write heatmap image %s\n", h->image_path);
+        }
+    }
+    free(h->image_path);
+    free(h->stats);
+    free(h->totals);
+}
+
+#else
+
+bool heatmap_open(Heatmap *h, const char *prefix, long window, bool per_byte) {
+    fprintf(stderr, "Memory heatmaps need a build configured with -DMEMORY_STATS=ON\n");
+    return false;
+}
+
+void heatmap_pause(Heatmap *h, bool paused) {
+}
+
+void heatmap_frame(Heatmap *h) {
+}
+
+void heatmap_close(Heatmap *h) {
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef HEATMAP_H
+#define HEATMAP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "emu8080.h"
+
+#define HEATMAP_WINDOW 60               // Frames per CSV window unless --heatmap-window says otherwise
+
+/* Collects the access counts of a MEMORY_STATS build. Every window of frames
+ * goes to PREFIX.csv, per 256-byte page or per byte, and the whole session
+ * to PREFIX.ppm as one pixel per byte: red for writes, green for reads and
+ * blue for instruction fetches, on a log scale.
+ */
+typedef struct Heatmap {
+    FILE *csv;
+    char *image_path;
+    bool per_byte;
+    long window;
+    long frames;                        // Frames in the current window
+    long windows;
+
+    struct MemoryStats *stats;          // The current window's counts
+    uint64_t *totals;                   // Reads, writes and fetches for the session
+} Heatmap;
+
+bool heatmap_open(Heatmap *heatmap, const char *prefix, long window, bool per_byte);
+void heatmap_pause(Heatmap *heatmap, bool paused);
+void heatmap_frame(Heatmap *heatmap);
+void heatmap_close(Heatmap *heatmap);
+
+#endif
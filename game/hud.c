@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "hud.h"
+#include "pacing.h"
+
+#define GLYPH_WIDTH 3
+#define GLYPH_HEIGHT 5
+#define CELL_WIDTH ((GLYPH_WIDTH + 1) * HUD_SCALE)
+#define CELL_HEIGHT ((GLYPH_HEIGHT + 1) * HUD_SCALE)
+#define MARGIN (2 * HUD_SCALE)
+
+/* 3x5 font, one octal digit per row from the top, the high bit on the left.
+ * Only what the overlay prints, lower case is drawn as upper case.
+ */
+static const uint16_t font[] = {
+    ['%' - ' '] = 051245, ['-' - ' '] = 000700, ['.' - ' '] = 000002, ['/' - ' '] = 011244,
+    ['0' - ' '] = 075557, ['1' - ' '] = 026227, ['2' - ' '] = 071747, ['3' - ' '] = 071717,
+    ['4' - ' '] = 055711, ['5' - ' '] = 074717, ['6' - ' '] = 074757, ['7' - ' '] = 071111,
+    ['8' - ' '] = 075757, ['9' - ' '] = 075717, [':' - ' '] = 002020,
+    ['A' - ' '] = 025755, ['B' - ' '] = 065656, ['C' - ' '] = 034443, ['D' - ' '] = 065556,
+    ['E' - ' '] = 074647, ['F' - ' '] = 074644, ['G' - ' '] = 034553, ['H' - ' '] = 055755,
+    ['I' - ' '] = 072227, ['J' - ' '] = 011152, ['K' - ' '] = 055655, ['L' - ' '] = 044447,
+    ['M' - ' '] = 057755, ['N' - ' '] = 065555, ['O' - ' '] = 025552, ['P' - ' '] = 065644,
+    ['Q' - ' '] = 025563, ['R' - ' '] = 065655, ['S' - ' '] = 034216, ['T' - ' '] = 072222,
+    ['U' - ' '] = 055557, ['V' - ' '] = 055552, ['W' - ' '] = 055775, ['X' - ' '] = 055255,
+    ['Y' - ' '] = 055222, ['Z' - ' '] = 071247
+};
+#define NUM_GLYPHS (sizeof(font) / sizeof(font[0]))
+
+void hud_reset(HudMeter *m, uint64_t instructions) {
+    memset(m, 0, sizeof(*m));
+    m->period_start = m->last_frame = pacing_now_ns();
+    m->instructions = instructions;
+    m->min_ns = UINT64_MAX;
+    memcpy(m->phase_ns, phase_ns, sizeof(m->phase_ns));
+    snprintf(m->text.lines[0], HUD_COLUMNS + 1, "HUD ON");
+}
+
+// Called at the end of every frame while the overlay is on
+void hud_frame(HudMeter *m, uint64_t instructions, unsigned audio_queue) {
+    uint64_t now = pacing_now_ns();
+    uint64_t frame_ns = now - m->last_frame;
+
+    m->last_frame = now;
+    m->frames++;
+    m->sum_ns += frame_ns;
+    m->min_ns = frame_ns < m->min_ns ? frame_ns : m->min_ns;
+    m->max_ns = frame_ns > m->max_ns ? frame_ns : m->max_ns;
+
+    uint64_t period_ns = now - m->period_start;
+    if (period_ns < HUD_PERIOD_NS) {
+        return;
+    }
+
+    int share[NUM_PHASES];
+    for (int i = 0; i < NUM_PHASES; i++) {
+        share[i] = (int)((phase_ns[i] - m->phase_ns[i]) * 100 / period_ns);
+    }
+
+    snprintf(m->text.lines[0], HUD_COLUMNS + 1, "FPS %.1f  MIPS %.2f",
+             m->frames * 1e9 / period_ns, (instructions - m->instructions) * 1e3 / period_ns);
+    snprintf(m->text.lines[1], HUD_COLUMNS + 1, "FRAME MS %.1f/%.1f/%.1f",
+             m->min_ns / 1e6, m->sum_ns / 1e6 / m->frames, m->max_ns / 1e6);
+    snprintf(m->text.lines[2], HUD_COLUMNS + 1, "CPU %d%% RENDER %d%% INPUT %d%% SLEEP %d%%",
+             share[PHASE_CPU], share[PHASE_RENDER], share[PHASE_INPUT], share[PHASE_SLEEP]);
+    snprintf(m->text.lines[3], HUD_COLUMNS + 1, "AUDIO QUEUE %u", audio_queue);
+
+    m->period_start = now;
+    m->instructions = instructions;
+    m->frames = 0;
+    m->sum_ns = 0;
+    m->min_ns = UINT64_MAX;
+    m->max_ns = 0;
+    memcpy(m->phase_ns, phase_ns, sizeof(m->phase_ns));
+}
+
+static void _fill(SDL_Surface *surface, int x, int y, int w, int h, uint32_t color) {
+    for (int row = y; row < y + h; row++) {
+        uint32_t *pixels = (uint32_t *)surface->pixels + row * surface->w;
+        for (int col = x; col < x + w; col++) {
+            pixels[col] = color;
+        }
+    }
+}
+
+// Draws onto the window surface over the game, in its top left corner
+void hud_draw(SDL_Surface *surface, const HudText *text) {
+    size_t width = 0;
+    for (int i = 0; i < HUD_LINES; i++) {
+        size_t len = strlen(text->lines[i]);
+        width = len > width ? len : width;
+    }
+
+    _fill(surface, 0, 0, width * CELL_WIDTH + 2 * MARGIN, HUD_LINES * CELL_HEIGHT + 2 * MARGIN, 0x000000);
+
+    for (int i = 0; i < HUD_LINES; i++) {
+        for (const char *c = text->lines[i]; *c; c++) {
+            unsigned index = toupper((unsigned char)*c) - ' ';
+            uint16_t glyph = index < NUM_GLYPHS ? font[index] : 0;
+            int x = MARGIN + (c - text->lines[i]) * CELL_WIDTH;
+            int y = MARGIN + i * CELL_HEIGHT;
+
+            for (int bit = 0; bit < GLYPH_WIDTH * GLYPH_HEIGHT; bit++) {
+                if (glyph & (1 << (GLYPH_WIDTH * GLYPH_HEIGHT - 1 - bit))) {
+                    _fill(surface, x + (bit % GLYPH_WIDTH) * HUD_SCALE, y + (bit / GLYPH_WIDTH) * HUD_SCALE,
+                          HUD_SCALE, HUD_SCALE, HUD_COLOR);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <SDL2/SDL.h>
+#include "phase.h"
+
+#define HUD_LINES 4
+#define HUD_COLUMNS 40                  // Keeps the box inside the top half of the screen
+#define HUD_PERIOD_NS 500000000ULL      // How often the figures are refreshed
+#define HUD_SCALE 2                     // Window pixels per font pixel
+#define HUD_COLOR 0xFFFF00
+
+// What the overlay shows, handed to the render thread along with the frame
+typedef struct HudText {
+    char lines[HUD_LINES][HUD_COLUMNS + 1];
+} HudText;
+
+/* Averages the main loop's figures over HUD_PERIOD_NS and formats them.
+ * Only fed while the overlay is on, so it costs nothing otherwise.
+ */
+typedef struct HudMeter {
+    HudText text;
+    uint64_t period_start;
+    uint64_t last_frame;
+    uint64_t instructions;              // At the start of the period
+    uint64_t phase_ns[NUM_PHASES];
+    unsigned long frames;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t sum_ns;
+} HudMeter;
+
+void hud_reset(HudMeter *meter, uint64_t instructions);
+void hud_frame(HudMeter *meter, uint64_t instructions, unsigned audio_queue);
+void hud_draw(SDL_Surface *surface, const HudText *text);
+
+#endif
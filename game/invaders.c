@@ -2,6 +2,23 @@
 #include <SDL2/SDL.h>
 #include "emu8080.h"
 #include "hardware.h"
+#include "render.h"
+#include "capture.h"
+#include "options.h"
+#include "framehash.h"
+#include "shmfb.h"
+#include "pacing.h"
+#include "latency.h"
+#include "assets.h"
+#include "trace.h"
+#include "profile.h"
+#include "callgraph.h"
+#include "sampler.h"
+#include "phase.h"
+#include "heatmap.h"
+#include "timeline.h"
+#include "shmstats.h"
+#include "debugger.h"
 
 // Map IO ports to CPU IO memory
 void port_init(State8080 *cpu) {
@@ -16,10 +33,111 @@ void port_init(State8080 *cpu) {
     cpu->output[SOUND2] = write_snd2;
 
     cpu->output[WATCHDOG] = write_watchdog;
+
+    audio_set_clock(cpu);
+}
+
+// Loads a ROM built into the binary, or failing that the file from ../roms
+static bool _load_rom(State8080 *state, const char *name, uint16_t offset) {
+    char path[64];
+
+    snprintf(path, sizeof(path), "roms/%s", name);
+    const Asset *asset = asset_find(path);
+    if (asset) {
+        return LoadRomFromBuffer(state, asset->data, asset->size, offset);
+    }
+
+    snprintf(path, sizeof(path), "../roms/%s", name);
+    return LoadRomIntoMemory(state, path, offset);
+}
+
+// Whatever is watching the CPU an instruction at a time
+typedef struct Instruments {
+    Tracer *tracer;
+    OpcodeProfile *profile;
+    CallGraph *calls;
+} Instruments;
+
+// Runs one instruction past every instrument that is watching
+static void _step(void *data, State8080 *state) {
+    const Instruments *in = data;
+    uint8_t opcode = NextOpcode8080(state);
+    uint16_t pc = state->pc;
+    uint16_t sp = state->sp;
+
+    if (in->tracer) {
+        trace_step(in->tracer, state);
+    }
+    if (in->profile) {
+        profile_step(in->profile, state, opcode);
+    } else {
+        Emulate8080Op(state);
+    }
+    if (in->calls && state->sp != sp && (opcode_info[opcode].kind & OP_BRANCH)) {
+        callgraph_branch(in->calls, state, opcode, pc, sp);
+    }
+}
+
+// Runs the CPU up to a cycle count and returns how many instructions that
+// took. Instruments are checked here rather than per instruction, so the loop
+// without any has nothing added to it.
+static unsigned long _run_until(State8080 *state, unsigned long cycles, const Instruments *in) {
+    unsigned long count = 0;
+
+    if (in) {
+        for (; state->total_cycles < cycles; count++) {
+            _step((void *)in, state);
+        }
+        return count;
+    }
+
+    for (; state->total_cycles < cycles; count++) {
+        Emulate8080Op(state);
+    }
+    return count;
 }
 
-// Initializes SDL
-bool init_SDL() {
+// While the debugger has anything to stop for, whole half frames run on its
+// loop instead, starting from the next instruction, with the same instruments.
+// Run-ahead frames never do.
+static unsigned long _run_half(State8080 *state, unsigned long cycles, const Instruments *in, Debugger *debugger) {
+    if (debugger && debugger_active(debugger)) {
+        return debugger_run_until(debugger, state, cycles, in ? _step : NULL, (void *)in);
+    }
+    return _run_until(state, cycles, in);
+}
+
+// Emulates a whole frame, raising both of the video hardware's interrupts
+static void _run_frame(State8080 *state) {
+    _run_until(state, VBLANK_RATE / 2, NULL);
+    cpu_req_interrupt(state, 0xcf);
+
+    _run_until(state, VBLANK_RATE, NULL);
+    cpu_req_interrupt(state, 0xd7);
+    state->total_cycles = 0;
+}
+
+/* Speeds the F3 key cycles through, 0 is uncapped */
+static const double speed_steps[] = { 1, 2, 4, 8, 0 };
+#define NUM_SPEED_STEPS (sizeof(speed_steps) / sizeof(speed_steps[0]))
+
+// The step at or above a speed, where F3 carries on from
+static size_t _speed_step(double speed) {
+    size_t step = 0;
+
+    while (speed && step < NUM_SPEED_STEPS - 1 && speed_steps[step] < speed) {
+        step++;
+    }
+    return speed ? step : NUM_SPEED_STEPS - 1;
+}
+
+// Initializes SDL, without video when running headless
+bool init_SDL(bool headless) {
+    if (headless) {
+        // Sounds still load for the capture track, but nothing is played
+        SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+        return SDL_Init(SDL_INIT_EVENTS | SDL_INIT_AUDIO) >= 0;
+    }
     return SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) >= 0;
 }
 
@@ -38,65 +156,417 @@ SDL_Window *create_window() {
     return new_window;
 }
 
-int main(void) {
+int main(int argc, char **argv) {
+    uint64_t launched = pacing_now_ns();
+
+    Options opts;
+    if (!options_parse(&opts, argc, argv)) {
+        options_usage(argv[0]);
+        return 1;
+    }
+
+    // Before any other thread starts, so they all record from their first span
+    if (opts.timeline_path) {
+        timeline_open();
+        timeline_name_thread("main");
+    }
+
     State8080 state;
     Reset8080(&state);
-    if    (!LoadRomIntoMemory(&state, "../roms/invaders.h", 0x0000)
-        || !LoadRomIntoMemory(&state, "../roms/invaders.g", 0x0800)
-        || !LoadRomIntoMemory(&state, "../roms/invaders.f", 0x1000)
-        || !LoadRomIntoMemory(&state, "../roms/invaders.e", 0x1800)) {
+    if    (!_load_rom(&state, "invaders.h", 0x0000)
+        || !_load_rom(&state, "invaders.g", 0x0800)
+        || !_load_rom(&state, "invaders.f", 0x1000)
+        || !_load_rom(&state, "invaders.e", 0x1800)) {
         fprintf(stderr, "Could not open Space Invaders ROM files.\n");
         return 1;
     }
     port_init(&state);
+    uint64_t roms_loaded = pacing_now_ns();
 
-    if (!init_SDL()) {
+    if (!init_SDL(opts.headless)) {
         fprintf(stderr, "Could not initialize SDL: %s\n", SDL_GetError());
         return 1;
     }
+    input_init();
+
+    SDL_Window *window = NULL;
+    SDL_Surface *surface = NULL;
+    Renderer renderer;
 
-    SDL_Window *window = create_window();
-    if (!window) {
-        fprintf(stderr, "Could not create SDL window: %s\n", SDL_GetError());
+    if (!opts.headless) {
+        window = create_window();
+        if (!window) {
+            fprintf(stderr, "Could not create SDL window: %s\n", SDL_GetError());
+            return 1;
+        }
+
+        surface = SDL_GetWindowSurface(window);
+        if (!surface) {
+            fprintf(stderr, "Could not create SDL surface: %s\n", SDL_GetError());
+            return 1;
+        }
+    }
+
+    if (!audio_init()) {
+        fprintf(stderr, "Could not initialize SDL mixer.\n");
+    }
+
+    // Frames are drawn and presented on their own thread
+    if (!opts.headless && !render_init(&renderer, window, surface)) {
+        fprintf(stderr, "Could not start render thread: %s\n", SDL_GetError());
         return 1;
     }
 
-    SDL_Surface *surface = SDL_GetWindowSurface(window);
-    if (!surface) {
-        fprintf(stderr, "Could not create SDL surface: %s\n", SDL_GetError());
+    Capture capture;
+    if (opts.capture_path && !capture_open(&capture, opts.capture_path, opts.headless)) {
+        fprintf(stderr, "Could not open capture output %s\n", opts.capture_path);
         return 1;
     }
+    if (opts.capture_path) {
+        audio_wait_loaded();    // The track should not depend on how fast sounds decode
+    }
 
-    if (!audio_init()) {
-        fprintf(stderr, "Could not initialize SDL mixer.\n");
+    FILE *hash_log = NULL;
+    if (opts.hash_log_path && !(hash_log = hashlog_create(opts.hash_log_path))) {
+        fprintf(stderr, "Could not create hash log %s\n", opts.hash_log_path);
+        return 1;
+    }
+
+    ShmExport shm;
+    if (opts.shm_name && !shmfb_open(&shm, opts.shm_name, opts.shm_formats)) {
+        fprintf(stderr, "Could not create shared memory framebuffer %s\n", opts.shm_name);
+        return 1;
+    }
+
+    Tracer tracer;
+    if (opts.trace_path && !trace_open(&tracer, opts.trace_path)) {
+        fprintf(stderr, "Could not create trace file %s\n", opts.trace_path);
+        return 1;
+    }
+
+    static OpcodeProfile profile;
+    if (opts.profile_path) {
+        profile_init(&profile, opts.profile_sample);
+    }
+
+    CallGraph calls;
+    if (opts.callgraph_path && !callgraph_open(&calls, opts.symbols_path)) {
+        fprintf(stderr, "Could not start the call graph profiler%s%s\n",
+                opts.symbols_path ? " with symbols from " : "", opts.symbols_path ? opts.symbols_path : "");
+        return 1;
+    }
+
+    Instruments instruments = {
+        .tracer = opts.trace_path ? &tracer : NULL,
+        .profile = opts.profile_path ? &profile : NULL,
+        .calls = opts.callgraph_path ? &calls : NULL
+    };
+    const Instruments *watch = (instruments.tracer || instruments.profile || instruments.calls) ? &instruments : NULL;
+
+    Heatmap heatmap;
+    if (opts.heatmap_prefix && !heatmap_open(&heatmap, opts.heatmap_prefix, opts.heatmap_window, opts.heatmap_bytes)) {
+        fprintf(stderr, "Could not start the memory heatmap %s\n", opts.heatmap_prefix);
+        return 1;
+    }
+
+    LatencyProbe probe;
+    if (opts.latency_trials && !latency_open(&probe, opts.latency_trials)) {
+        fprintf(stderr, "Could not start the latency probe\n");
+        return 1;
+    }
+
+    ShmStatsExport stats;
+    if (opts.stats_name && !shmstats_open(&stats, opts.stats_name, phase_names, NUM_PHASES)) {
+        fprintf(stderr, "Could not create shared memory metrics %s\n", opts.stats_name);
+        return 1;
+    }
+    // Latency figures only mean something against a real time schedule
+    bool paced = !opts.headless || opts.latency_trials;
+
+    // Run-ahead rewinds to here every frame
+    static State8080 snapshot;
+    BoardState board;
+
+    // After SDL, whose SIGINT handler it replaces
+    static Debugger debug;
+    Debugger *debugger = NULL;
+    if (opts.debug) {
+        if (!debugger_open(&debug, true)) {
+            fprintf(stderr, "Could not start the debugger\n");
+            return 1;
+        }
+        debugger = &debug;
     }
 
+    if (opts.sample_hz && !sampler_start(&state, opts.sample_hz)) {
+        fprintf(stderr, "Could not start the PC sampler\n");
+        return 1;
+    }
+
+    long frames = 0;
+    uint64_t instructions = 0;
+    HudMeter meter;
+    const HudText *hud = NULL;
+    if (opts.hud) {
+        hud_reset(&meter, instructions);
+        hud = &meter.text;
+    }
+    phase_timed = hud || opts.timeline_path || opts.stats_name;
+    size_t speed_step = _speed_step(opts.speed);
+    Pacer pacer;
+    pacing_init(&pacer, opts.speed);
+    audio_set_speed(opts.speed);
+
     while(!state.exit) {
-        // Draw the screen and handle input
-        display_draw(window, surface, &state);
-        state.exit = !handle_input();
+        uint64_t frame_started = timeline_begin();
+        // When the host is behind, the frame is still emulated but not drawn
+        bool render = !opts.headless && pacing_render_due(&pacer);
 
-        uint32_t ticks = SDL_GetTicks();
+        // Off real time, input is only polled on drawn frames to leave the
+        // host to the CPU core
+        bool poll_input = render || pacer.speed == 1 || opts.headless;
+        phase_enter(PHASE_INPUT);
+        if (poll_input) {
+            state.exit = !handle_input();
+        }
 
-        // Execute all cycles before a half-screen refresh
-        while (state.total_cycles < (VBLANK_RATE / 2)) {
-            Emulate8080Op(&state);
+        int speed_presses = input_speed_presses();
+        if (speed_presses) {
+            speed_step = (speed_step + speed_presses) % NUM_SPEED_STEPS;
+            pacing_set_speed(&pacer, speed_steps[speed_step]);
+            audio_set_speed(pacer.speed);
         }
+
+        // The overlay needs the phase times, which are otherwise only kept on demand
+        if (input_hud_presses() % 2) {
+            hud = hud ? NULL : &meter.text;
+            if (hud) {
+                hud_reset(&meter, instructions);
+            }
+        }
+        phase_timed = hud || opts.timeline_path || opts.stats_name;
+
+        // Execute all cycles before a half-screen refresh
+        phase_enter(PHASE_CPU);
+        instructions += _run_half(&state, VBLANK_RATE / 2, watch, debugger);
         cpu_req_interrupt(&state, 0xcf);      // 0xcf = RST 1
 
-        // Execute all cycles before a full-screen refresh
-        while (state.total_cycles < VBLANK_RATE) {
-            Emulate8080Op(&state);
+        // The beam is past mid-screen, the top half can go out now
+        phase_enter(PHASE_RENDER);
+        if (render && !opts.run_ahead) {
+            render_publish(&renderer, &state.memory[VIDEO_MEMORY_START], RENDER_TOP_HALF, hud);
+        }
+        if (opts.latency_trials && !opts.run_ahead) {
+            latency_check(&probe, state.memory, RENDER_TOP_HALF);
         }
+        phase_enter(PHASE_SLEEP);
+        if (paced) {
+            pacing_wait_half(&pacer);
+        }
+
+        // Buttons pressed during the first half are seen by the second
+        phase_enter(PHASE_INPUT);
+        if (poll_input) {
+            input_pump();
+        }
+
+        // Execute all cycles before a full-screen refresh
+        phase_enter(PHASE_CPU);
+        instructions += _run_half(&state, VBLANK_RATE, watch, debugger);
         cpu_req_interrupt(&state, 0xd7);      // 0xd7 = RST 2
 
+        // And the bottom half once it has been scanned out
+        phase_enter(PHASE_RENDER);
+        if (render && !opts.run_ahead) {
+            render_publish(&renderer, &state.memory[VIDEO_MEMORY_START], RENDER_BOTTOM_HALF, hud);
+        }
+        if (opts.latency_trials && !opts.run_ahead &&
+            !latency_check(&probe, state.memory, RENDER_BOTTOM_HALF)) {
+            state.exit = true;
+        }
+
+        if (opts.capture_path) {
+            capture_frame(&capture, &state.memory[VIDEO_MEMORY_START], state.cycles);
+        }
+
+        if (opts.shm_name) {
+            shmfb_publish(&shm, &state.memory[VIDEO_MEMORY_START]);
+        }
+
+        if (opts.heatmap_prefix) {
+            heatmap_frame(&heatmap);
+        }
+
+        if (hash_log) {
+            FrameHash hash = {
+                .frame = frames,
+                .vram = hash64(&state.memory[VIDEO_MEMORY_START], DISP_BYTES, 0),
+                .ram = hash64(&state.memory[RAM_START], RAM_SIZE, 0)
+            };
+            hashlog_write(hash_log, &hash);
+        }
+
+        if (++frames == opts.frames) {
+            state.exit = true;
+        }
+        if (frames == 1) {
+            uint64_t now = pacing_now_ns();
+            fprintf(stderr, "Startup: %.1f ms to the first frame (ROMs %.2f ms, SDL and devices %.1f ms)\n",
+                    (now - launched) / 1e6, (roms_loaded - launched) / 1e6, (now - roms_loaded) / 1e6);
+        }
+
         // Reset cycle counter and sleep until end of refresh period
         state.total_cycles = 0;
-        SDL_Delay((1000 / REFRESH_RATE) - (SDL_GetTicks() - ticks));
+
+        // Show where the game will be a few frames from now, then rewind.
+        // Capture, hashes and sound all stay on the real timeline.
+        if (opts.run_ahead) {
+            bool trials_left = true;
+
+            phase_enter(PHASE_CPU);
+            SaveState8080(&state, &snapshot);
+            board_save(&board);
+            audio_set_speculative(true);
+            if (opts.heatmap_prefix) {
+                heatmap_pause(&heatmap, true);
+            }
+
+            for (long i = 0; i < opts.run_ahead; i++) {
+                _run_frame(&state);
+            }
+
+            phase_enter(PHASE_RENDER);
+            if (render) {
+                render_publish(&renderer, &state.memory[VIDEO_MEMORY_START], RENDER_FULL, hud);
+            }
+            if (opts.latency_trials) {
+                latency_check(&probe, state.memory, RENDER_TOP_HALF);
+                trials_left = latency_check(&probe, state.memory, RENDER_BOTTOM_HALF);
+            }
+
+            audio_set_speculative(false);
+            if (opts.heatmap_prefix) {
+                heatmap_pause(&heatmap, false);
+            }
+            RestoreState8080(&state, &snapshot);
+            board_restore(&board);
+            state.exit |= !trials_left;
+        }
+
+        phase_enter(PHASE_SLEEP);
+        if (paced) {
+            pacing_wait(&pacer);
+        }
+
+        if (opts.stats_name) {
+            StatsSample sample = {
+                .frames = frames,
+                .instructions = instructions,
+                .cycles = state.cycles,
+                .late_frames = pacer.stats.late,
+                .skipped_frames = pacer.stats.skipped,
+                .dropped_halves = opts.headless ? 0 : atomic_load(&renderer.dropped),
+                .audio_underruns = audio_underruns(),
+                .phase_ns = phase_ns
+            };
+            shmstats_publish(&stats, &sample);
+        }
+
+        if (hud) {
+            hud_frame(&meter, instructions, audio_queue_depth());
+        }
+
+        // Overruns get their own name so they can be searched for
+        if (frame_started) {
+            timeline_record(paced && pacer.behind ? "late frame" : "frame",
+                            frame_started, pacing_now_ns(), frames - 1);
+        }
+    }
+    phase_enter(PHASE_OTHER);
+
+    if (opts.sample_hz) {
+        sampler_stop();
+        sampler_report(state.memory);
+    }
+
+    if (opts.profile_path) {
+        profile_report(&profile);
+        if (!profile_write_csv(&profile, opts.profile_path)) {
+            fprintf(stderr, "Could not write profile %s\n", opts.profile_path);
+        }
+    }
+
+    if (opts.callgraph_path) {
+        callgraph_finish(&calls, state.cycles);
+        callgraph_report(&calls);
+        if (!callgraph_write_folded(&calls, opts.callgraph_path)) {
+            fprintf(stderr, "Could not write call graph %s\n", opts.callgraph_path);
+        }
+        callgraph_close(&calls);
+    }
+
+    if (opts.heatmap_prefix) {
+        heatmap_close(&heatmap);
+    }
+
+    if (debugger) {
+        debugger_close(debugger);
+    }
+
+    if (opts.latency_trials) {
+        latency_report(&probe);
+        latency_close(&probe);
+    }
+
+    if (hash_log) {
+        fclose(hash_log);
     }
 
-    SDL_FreeSurface(surface);
-    SDL_DestroyWindow(window);
+    if (instruments.tracer) {
+        trace_close(&tracer);
+        fprintf(stderr, "Traced %llu instructions, waited for the writer %lu times\n",
+                (unsigned long long)tracer.written, tracer.stalls);
+    }
+
+    if (opts.shm_name) {
+        shmfb_close(&shm);
+    }
+
+    if (opts.stats_name) {
+        shmstats_close(&stats);
+    }
+
+    if (opts.capture_path) {
+        capture_close(&capture);
+        fprintf(stderr, "Captured %lu frames, %lu dropped and repeated\n", capture.frames, capture.dropped);
+    }
+
+    if (!opts.headless) {
+        PacingStats pacing;
+        pacing_stats(&pacer, &pacing);
+        printf("Frame time: min %.2f ms, avg %.2f ms, max %.2f ms, jitter %.3f ms\n",
+               pacing.min_ns / 1e6, pacing.mean_ns / 1e6, pacing.max_ns / 1e6, pacing.jitter_ns / 1e6);
+        printf("Frames: %lu, %lu late, %lu not drawn, %lu resyncs\n",
+               (unsigned long)pacing.frames, (unsigned long)pacing.late,
+               (unsigned long)pacing.skipped, (unsigned long)pacing.resyncs);
+
+        render_quit(&renderer);
+        printf("Half frames: %lu presented, %lu dropped, %lu late\n",
+               atomic_load(&renderer.presented),
+               atomic_load(&renderer.dropped),
+               atomic_load(&renderer.late));
+
+        SDL_FreeSurface(surface);
+        SDL_DestroyWindow(window);
+    }
+    input_quit();
     audio_quit();
+
+    if (opts.timeline_path) {
+        if (!timeline_write(opts.timeline_path)) {
+            fprintf(stderr, "Could not write timeline %s\n", opts.timeline_path);
+        }
+        timeline_close();
+    }
     SDL_Quit();
 }
\ No newline at end of file
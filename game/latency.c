@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "latency.h"
+#include "pacing.h"
+
+/* Game variables in RAM, used only to decide when a trial can start */
+#define GAME_MODE 0x20EF                // Non-zero while a game is being played
+#define PLAYER_ALIVE 0x2015             // 0xFF unless the cannon is exploding
+#define SHOT_STATUS 0x2025              // Zero when a new shot can be fired
+
+/* VRAM rows, counted in bytes up from the bottom of the screen */
+#define CANNON_ROW 4
+#define SHOT_ROW 5
+
+#define FRAME_NS (1000000000ULL / REFRESH_RATE)
+
+static const SDL_Keycode trial_keys[] = { SDLK_RIGHT, SDLK_LEFT, SDLK_SPACE };
+#define NUM_TRIAL_KEYS (sizeof(trial_keys) / sizeof(trial_keys[0]))
+
+static void _push_key(SDL_Keycode key, bool down) {
+    SDL_Event event = { 0 };
+
+    event.type = down ? SDL_KEYDOWN : SDL_KEYUP;
+    event.key.timestamp = SDL_GetTicks();
+    event.key.keysym.sym = key;
+    SDL_PushEvent(&event);
+}
+
+static uint32_t _xorshift(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// Presses the armed key somewhere within the next frame
+static int _injector_thread(void *data) {
+    LatencyProbe *p = data;
+
+    while (SDL_SemWait(p->arm) == 0 && atomic_load(&p->running)) {
+        pacing_sleep_until(pacing_now_ns() + _xorshift(&p->seed) % FRAME_NS);
+
+        atomic_store(&p->press_half, atomic_load(&p->half));
+        atomic_store(&p->press_ns, pacing_now_ns());
+        _push_key(p->key, true);
+        atomic_store(&p->pressed, true);
+    }
+
+    return 0;
+}
+
+static void _sample_rows(const uint8_t *vram, uint8_t rows[2][DISP_WIDTH]) {
+    for (int x = 0; x < DISP_WIDTH; x++) {
+        rows[0][x] = vram[x * 32 + CANNON_ROW];
+        rows[1][x] = vram[x * 32 + SHOT_ROW];
+    }
+}
+
+static void _set_state(LatencyProbe *p, LATENCY_STATE state) {
+    p->state = state;
+    p->state_frames = 0;
+}
+
+// Looks for a steady cannon, and starts a trial against it
+static void _try_arm(LatencyProbe *p, const uint8_t *memory, uint8_t rows[2][DISP_WIDTH]) {
+    bool steady = memcmp(rows, p->last, sizeof(p->last)) == 0;
+    SDL_Keycode key = trial_keys[p->step % NUM_TRIAL_KEYS];
+    int x0 = -1, x1 = -1;
+
+    for (int x = 0; x < DISP_WIDTH; x++) {
+        if (rows[0][x]) {
+            x0 = x0 < 0 ? x : x0;
+            x1 = x;
+        }
+    }
+
+    if (!steady || x0 < 0 || memory[PLAYER_ALIVE] != 0xFF ||
+        (key == SDLK_SPACE && p->shot_free < LATENCY_SHOT_FRAMES)) {
+        return;
+    }
+
+    p->key = key;
+    p->x0 = x0 > 2 ? x0 - 2 : 0;
+    p->x1 = x1 + 2 < DISP_WIDTH ? x1 + 2 : DISP_WIDTH - 1;
+    memcpy(p->baseline, rows, sizeof(p->baseline));
+    p->step++;
+
+    _set_state(p, LATENCY_ARMED);
+    SDL_SemPost(p->arm);
+}
+
+// Whether the watched columns that have been scanned out differ from the baseline
+static bool _responded(const LatencyProbe *p, uint8_t rows[2][DISP_WIDTH], RENDER_HALF half) {
+    int last = (half == RENDER_TOP_HALF) ? DISP_WIDTH / 2 - 1 : p->x1;
+
+    for (int x = p->x0; x <= p->x1 && x <= last; x++) {
+        if (rows[0][x] != p->baseline[0][x] || rows[1][x] != p->baseline[1][x]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool latency_open(LatencyProbe *p, long trials) {
+    memset(p, 0, sizeof(*p));
+    p->trials = trials;
+    p->seed = (uint32_t)pacing_now_ns() | 1;
+    p->frames = malloc(trials * sizeof(double));
+    p->ms = malloc(trials * sizeof(double));
+    p->arm = SDL_CreateSemaphore(0);
+    if (!p->frames || !p->ms || !p->arm) {
+        latency_close(p);
+        return false;
+    }
+
+    atomic_init(&p->running, true);
+    atomic_init(&p->pressed, false);
+    atomic_init(&p->half, 0);
+    p->injector = SDL_CreateThread(_injector_thread, "latency", p);
+    if (!p->injector) {
+        latency_close(p);
+        return false;
+    }
+
+    _set_state(p, LATENCY_COIN);
+    return true;
+}
+
+// Called at both half-frame points, returns false once every trial has run
+bool latency_check(LatencyProbe *p, const uint8_t *memory, RENDER_HALF half) {
+    const uint8_t *vram = memory + VIDEO_MEMORY_START;
+    uint8_t rows[2][DISP_WIDTH];
+    unsigned now_half = atomic_load(&p->half);
+
+    _sample_rows(vram, rows);
+
+    if (p->state == LATENCY_ARMED && atomic_load(&p->pressed)) {
+        if (memory[PLAYER_ALIVE] != 0xFF) {
+            p->aborted++;
+            _push_key(p->key, false);
+            _set_state(p, LATENCY_COOLDOWN);
+        } else if (_responded(p, rows, half)) {
+            uint64_t ns = pacing_now_ns() - atomic_load(&p->press_ns);
+            unsigned halves = now_half - atomic_load(&p->press_half) + 1;
+
+            p->frames[p->done] = halves / 2.0;
+            p->ms[p->done] = ns / 1e6;
+            p->done++;
+            _push_key(p->key, false);
+            _set_state(p, LATENCY_COOLDOWN);
+        }
+    }
+    atomic_store(&p->half, now_half + 1);
+
+    if (half == RENDER_TOP_HALF) {
+        return true;
+    }
+
+    p->state_frames++;
+    p->shot_free = memory[SHOT_STATUS] ? 0 : p->shot_free + 1;
+
+    switch (p->state) {
+    case LATENCY_COIN:
+        // Coin, then start a one player game; the cannon appears a few seconds later
+        if (p->state_frames == 1) {
+            _push_key(SDLK_c, true);
+        } else if (p->state_frames == 6) {
+            _push_key(SDLK_c, false);
+        } else if (p->state_frames == 30) {
+            _push_key(SDLK_RETURN, true);
+        } else if (p->state_frames == 35) {
+            _push_key(SDLK_RETURN, false);
+            _set_state(p, LATENCY_WAIT);
+        }
+        break;
+    case LATENCY_WAIT:
+        if (!memory[GAME_MODE] && p->state_frames > REFRESH_RATE) {
+            _set_state(p, LATENCY_COIN);        // Game over
+        } else {
+            _try_arm(p, memory, rows);
+        }
+        break;
+    case LATENCY_ARMED:
+        if (atomic_load(&p->pressed) && p->state_frames > LATENCY_TIMEOUT_FRAMES) {
+            p->timeouts++;
+            _push_key(p->key, false);
+            _set_state(p, LATENCY_COOLDOWN);
+        }
+        break;
+    case LATENCY_COOLDOWN:
+        atomic_store(&p->pressed, false);
+        if (p->state_frames > LATENCY_COOLDOWN_FRAMES) {
+            _set_state(p, LATENCY_WAIT);
+        }
+        break;
+    }
+
+    memcpy(p->last, rows, sizeof(p->last));
+    return p->done < p->trials;
+}
+
+static int _compare(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double _percentile(const double *sorted, long n, double pct) {
+    long i = (long)(pct / 100.0 * (n - 1) + 0.5);
+    return sorted[i];
+}
+
+void latency_report(LatencyProbe *p) {
+    long n = p->done;
+    long histogram[LATENCY_HISTOGRAM] = { 0 };
+    double mean = 0;
+
+    printf("Latency: %ld trials, %ld timed out, %ld aborted\n", n, p->timeouts, p->aborted);
+    if (!n) {
+        return;
+    }
+
+    for (long i = 0; i < n; i++) {
+        int bucket = (int)(p->frames[i] * 2) - 1;
+        histogram[bucket < LATENCY_HISTOGRAM ? bucket : LATENCY_HISTOGRAM - 1]++;
+        mean += p->ms[i] / n;
+    }
+
+    qsort(p->frames, n, sizeof(double), _compare);
+    qsort(p->ms, n, sizeof(double), _compare);
+
+    printf("  ms:     min %.2f, p50 %.2f, p90 %.2f, p99 %.2f, max %.2f, mean %.2f\n",
+           p->ms[0], _percentile(p->ms, n, 50), _percentile(p->ms, n, 90),
+           _percentile(p->ms, n, 99), p->ms[n - 1], mean);
+    printf("  frames: min %.1f, p50 %.1f, p90 %.1f, p99 %.1f, max %.1f\n",
+           p->frames[0], _percentile(p->frames, n, 50), _percentile(p->frames, n, 90),
+           _percentile(p->frames, n, 99), p->frames[n - 1]);
+
+    for (int i = 0; i < LATENCY_HISTOGRAM; i++) {
+        if (histogram[i]) {
+            printf("  %s%4.1f frames: %ld\n", i == LATENCY_HISTOGRAM - 1 ? ">=" : "  ",
+                   (i + 1) / 2.0, histogram[i]);
+        }
+    }
+}
+
+void latency_close(LatencyProbe *p) {
+    if (p->injector) {
+        atomic_store(&p->running, false);
+        SDL_SemPost(p->arm);
+        SDL_WaitThread(p->injector, NULL);
+    }
+    if (p->arm) {
+        SDL_DestroySemaphore(p->arm);
+    }
+    free(p->frames);
+    free(p->ms);
+}
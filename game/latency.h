@@ -0,0 +1,62 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
+#include "hardware.h"
+#include "render.h"
+
+#define LATENCY_TIMEOUT_FRAMES 30       // A press with no response by then is abandoned
+#define LATENCY_COOLDOWN_FRAMES 8       // Frames between a release and the next press
+#define LATENCY_SHOT_FRAMES 10          // Shot free for longer than any run-ahead before firing
+#define LATENCY_HISTOGRAM 16            // Half-frame buckets, the last one collects the rest
+
+typedef enum {
+    LATENCY_COIN,                       // Inserting a coin and starting a game
+    LATENCY_WAIT,                       // Waiting for a steady cannon to press against
+    LATENCY_ARMED,                      // The injector thread owns the press
+    LATENCY_COOLDOWN
+} LATENCY_STATE;
+
+/* Plays the game through the same event path as the keyboard: an injector
+ * thread pushes a key press at a random host time, and the frame loop scans
+ * VRAM around the cannon at every half-frame for the move or shot it causes.
+ * Nothing is rendered, so the figures are input-to-VRAM latency; the display
+ * adds its own scanout on top.
+ */
+typedef struct LatencyProbe {
+    long trials;
+    long done;
+    long timeouts;
+    long aborted;                       // Trials spoiled by the cannon being hit
+
+    LATENCY_STATE state;
+    long state_frames;
+    int step;                           // Which key the next trial presses
+    int shot_free;                      // Frames the player's shot has been available
+    SDL_Keycode key;
+    int x0, x1;                         // Columns watched around the cannon
+    uint8_t baseline[2][DISP_WIDTH];
+    uint8_t last[2][DISP_WIDTH];
+
+    SDL_Thread *injector;
+    SDL_sem *arm;
+    atomic_bool running;
+    atomic_bool pressed;
+    atomic_uint half;                   // Half-frames completed so far
+    atomic_uint press_half;
+    _Atomic uint64_t press_ns;
+    uint32_t seed;
+
+    double *frames;                     // Latency of each trial
+    double *ms;
+} LatencyProbe;
+
+bool latency_open(LatencyProbe *probe, long trials);
+bool latency_check(LatencyProbe *probe, const uint8_t *memory, RENDER_HALF half);
+void latency_report(LatencyProbe *probe);
+void latency_close(LatencyProbe *probe);
+
+#endif
@@ -0,0 +1,311 @@
+#include <string.h>
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
+#include "mixer.h"
+#include "timeline.h"
+
+typedef struct MixerSample {
+    int16_t *pcm;
+    int frames;
+} MixerSample;
+
+static SDL_AudioDeviceID device = 0;
+static int out_rate = 0;
+static int out_channels = 0;
+
+static MixerSample samples[MIXER_MAX_SOUNDS];
+
+/* Command queue, the emulator writes head and the callback writes tail */
+static MixerCommand queue[MIXER_QUEUE];
+static atomic_uint queue_head;
+static atomic_uint queue_tail;
+
+/* Emulated cycles per second, zero while the emulator runs uncapped */
+static atomic_ullong clock_rate;
+
+/* Voices and the cycle to sample mapping, owned by the audio callback */
+static MixerVoice voices[MIXER_VOICES];
+static int num_voices = 0;
+static uint64_t played = 0;         // Sample frames handed to the device so far
+
+// SDL does not report underruns, so a buffer asked for more than half a
+// buffer's time late counts as one
+static atomic_ulong underruns;
+static uint64_t underrun_ticks;
+static uint64_t last_callback = 0;
+static uint64_t anchor_rate = 0;
+static uint64_t anchor_cycle = 0;
+static uint64_t anchor_sample = 0;
+
+
+// Offset into the current buffer the command should start at
+static int64_t _sample_offset(uint64_t cycle, uint64_t rate, int frames) {
+    if (anchor_rate == rate && cycle >= anchor_cycle) {
+        int64_t target = anchor_sample + (cycle - anchor_cycle) * out_rate / rate;
+        int64_t offset = target - (int64_t)played;
+
+        if (offset >= -frames && offset < MIXER_MAX_AHEAD) {
+            return offset;
+        }
+    }
+
+    // First command, a speed change, or the clocks drifted apart
+    anchor_rate = rate;
+    anchor_cycle = cycle;
+    anchor_sample = played;
+    return 0;
+}
+
+static void _callback(void *userdata, uint8_t *stream, int len) {
+    int16_t *out = (int16_t *)stream;
+    int frames = len / (out_channels * sizeof(int16_t));
+    uint64_t rate = atomic_load_explicit(&clock_rate, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue_tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&queue_head, memory_order_acquire);
+    int done = 0;
+    uint64_t started = timeline_begin();
+    uint64_t now = SDL_GetPerformanceCounter();
+
+    if (last_callback && now - last_callback > underrun_ticks) {
+        atomic_fetch_add_explicit(&underruns, 1, memory_order_relaxed);
+    }
+    last_callback = now;
+
+    for (; tail != head; tail++) {
+        MixerCommand cmd = queue[tail & (MIXER_QUEUE - 1)];
+        int64_t offset = rate ? _sample_offset(cmd.cycle, rate, frames) : 0;
+
+        if (offset >= frames) {
+            break;                  // Due in a later buffer
+        }
+
+        if (offset > done) {
+            mixer_mix(voices, &num_voices, out + done * out_channels, offset - done);
+            done = offset;
+        }
+        mixer_apply(voices, &num_voices, cmd);
+    }
+    atomic_store_explicit(&queue_tail, tail, memory_order_release);
+
+    mixer_mix(voices, &num_voices, out + done * out_channels, frames - done);
+    played += frames;
+
+    if (started) {
+        timeline_name_thread("audio");
+        timeline_end("mix", started);
+    }
+}
+
+bool mixer_open(int rate, int channels, int frames) {
+    SDL_AudioSpec want = {
+        .freq = rate,
+        .format = AUDIO_S16SYS,
+        .channels = channels,
+        .samples = frames,
+        .callback = _callback
+    };
+    SDL_AudioSpec have;
+
+    atomic_init(&queue_head, 0);
+    atomic_init(&queue_tail, 0);
+    atomic_init(&clock_rate, 0);
+    num_voices = 0;
+    played = 0;
+    anchor_rate = 0;
+    atomic_init(&underruns, 0);
+    last_callback = 0;
+
+    // Sounds are converted to whatever rate the device settles on
+    out_rate = rate;
+    out_channels = channels;
+    device = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+    if (!device) {
+        return false;
+    }
+
+    out_rate = have.freq;
+    underrun_ticks = SDL_GetPerformanceFrequency() * have.samples * 3 / (2 * (uint64_t)have.freq);
+    SDL_PauseAudioDevice(device, 0);
+    return true;
+}
+
+unsigned long mixer_underruns(void) {
+    return atomic_load_explicit(&underruns, memory_order_relaxed);
+}
+
+// Commands the callback has not reached yet
+unsigned mixer_queue_depth(void) {
+    return atomic_load_explicit(&queue_head, memory_order_relaxed) -
+           atomic_load_explicit(&queue_tail, memory_order_relaxed);
+}
+
+void mixer_close(void) {
+    if (device) {
+        SDL_CloseAudioDevice(device);
+        device = 0;
+    }
+
+    for (int i = 0; i < MIXER_MAX_SOUNDS; i++) {
+        SDL_free(samples[i].pcm);
+        samples[i].pcm = NULL;
+    }
+}
+
+// Decodes a WAV and converts it to the output format ahead of time
+static bool _load(int sound, SDL_RWops *src) {
+    SDL_AudioSpec spec;
+    uint8_t *wav;
+    uint32_t wav_len;
+
+    if (sound < 0 || sound >= MIXER_MAX_SOUNDS || !src || !SDL_LoadWAV_RW(src, 1, &spec, &wav, &wav_len)) {
+        return false;
+    }
+
+    SDL_AudioCVT cvt;
+    if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq,
+                          AUDIO_S16SYS, out_channels, out_rate) < 0) {
+        SDL_FreeWAV(wav);
+        return false;
+    }
+
+    cvt.len = wav_len;
+    cvt.buf = SDL_malloc(wav_len * cvt.len_mult);
+    if (!cvt.buf) {
+        SDL_FreeWAV(wav);
+        return false;
+    }
+    memcpy(cvt.buf, wav, wav_len);
+    SDL_FreeWAV(wav);
+
+    if (SDL_ConvertAudio(&cvt) < 0) {
+        SDL_free(cvt.buf);
+        return false;
+    }
+
+    samples[sound].pcm = (int16_t *)cvt.buf;
+    samples[sound].frames = cvt.len_cvt / (out_channels * sizeof(int16_t));
+    return true;
+}
+
+bool mixer_load(int sound, const char *path) {
+    return _load(sound, SDL_RWFromFile(path, "rb"));
+}
+
+bool mixer_load_mem(int sound, const uint8_t *data, size_t size) {
+    return _load(sound, SDL_RWFromConstMem(data, size));
+}
+
+void mixer_spec(int *rate, int *channels) {
+    *rate = out_rate;
+    *channels = out_channels;
+}
+
+bool mixer_sample(int sound, const int16_t **pcm, int *frames) {
+    if (sound < 0 || sound >= MIXER_MAX_SOUNDS || !samples[sound].pcm) {
+        return false;
+    }
+
+    *pcm = samples[sound].pcm;
+    *frames = samples[sound].frames;
+    return true;
+}
+
+// Sets how many emulated cycles make up a second of audio, 0 plays commands on arrival
+void mixer_set_clock(uint64_t cycles_per_second) {
+    atomic_store_explicit(&clock_rate, cycles_per_second, memory_order_relaxed);
+}
+
+// Queues a command for the audio callback, dropping it if the queue is full
+bool mixer_command(MIXER_CMD type, int sound, uint64_t cycle) {
+    unsigned head = atomic_load_explicit(&queue_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&queue_tail, memory_order_acquire);
+
+    if (!device || head - tail == MIXER_QUEUE) {
+        return false;
+    }
+
+    queue[head & (MIXER_QUEUE - 1)] = (MixerCommand){ cycle, type, sound };
+    atomic_store_explicit(&queue_head, head + 1, memory_order_release);
+    return true;
+}
+
+void mixer_apply(MixerVoice *v, int *count, MixerCommand cmd) {
+    int kept = 0;
+
+    switch (cmd.type) {
+    case MIXER_PLAY:
+    case MIXER_LOOP:
+        if (*count == MIXER_VOICES) {
+            // Steal the oldest voice
+            memmove(&v[0], &v[1], sizeof(v[0]) * (MIXER_VOICES - 1));
+            (*count)--;
+        }
+        v[(*count)++] = (MixerVoice){ cmd.sound, 0, cmd.type == MIXER_LOOP };
+        break;
+    case MIXER_STOP:
+        for (int i = 0; i < *count; i++) {
+            if (v[i].sound != cmd.sound) {
+                v[kept++] = v[i];
+            }
+        }
+        *count = kept;
+        break;
+    case MIXER_STOP_ALL:
+        *count = 0;
+        break;
+    }
+}
+
+// Mixes `frames` sample frames of every voice into `out`, retiring finished voices
+void mixer_mix(MixerVoice *v, int *count, int16_t *out, int frames) {
+    int total = frames * out_channels;
+    int32_t acc[MIXER_FRAMES * 2];
+    int kept = 0;
+
+    // Large requests (the capture track) are mixed in device-sized chunks
+    while (total > (int)(sizeof(acc) / sizeof(acc[0]))) {
+        int chunk = (sizeof(acc) / sizeof(acc[0])) / out_channels;
+        mixer_mix(v, count, out, chunk);
+        out += chunk * out_channels;
+        total -= chunk * out_channels;
+        frames -= chunk;
+    }
+
+    memset(acc, 0, total * sizeof(acc[0]));
+
+    for (int i = 0; i < *count; i++) {
+        MixerVoice voice = v[i];
+        const MixerSample *sample = &samples[voice.sound];
+        if (!sample->pcm || !sample->frames) {
+            continue;
+        }
+
+        for (int done = 0; done < frames && voice.pos < sample->frames; ) {
+            int n = sample->frames - voice.pos;
+            if (n > frames - done) {
+                n = frames - done;
+            }
+
+            const int16_t *src = sample->pcm + voice.pos * out_channels;
+            int32_t *dst = acc + done * out_channels;
+            for (int k = 0; k < n * out_channels; k++) {
+                dst[k] += src[k];
+            }
+
+            done += n;
+            voice.pos += n;
+            if (voice.loop && voice.pos == sample->frames) {
+                voice.pos = 0;
+            }
+        }
+
+        if (voice.pos < sample->frames) {
+            v[kept++] = voice;
+        }
+    }
+    *count = kept;
+
+    for (int k = 0; k < total; k++) {
+        out[k] = acc[k] > INT16_MAX ? INT16_MAX : acc[k] < INT16_MIN ? INT16_MIN : acc[k];
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MIXER_FRAMES 512            // Device buffer, about 11.6 ms at 44.1 kHz
+#define MIXER_VOICES 16
+#define MIXER_QUEUE 256             // Must be a power of two
+#define MIXER_MAX_SOUNDS 16
+#define MIXER_MAX_AHEAD (MIXER_FRAMES * 8)  // Furthest ahead a command may be scheduled
+
+typedef enum {
+    MIXER_PLAY,
+    MIXER_LOOP,
+    MIXER_STOP,
+    MIXER_STOP_ALL
+} MIXER_CMD;
+
+typedef struct MixerCommand {
+    uint64_t cycle;                 // Emulated CPU cycle the port write happened on
+    uint8_t type;
+    uint8_t sound;
+} MixerCommand;
+
+typedef struct MixerVoice {
+    int sound;
+    int pos;                        // Next sample frame to mix
+    bool loop;
+} MixerVoice;
+
+/* A small software mixer running in the SDL audio callback. Sounds are
+ * converted to the device format once when loaded, and the emulator talks
+ * to the callback only through a lock-free command queue, so triggering a
+ * sound never blocks the CPU thread.
+ *
+ * Commands carry the cycle they were issued on. The emulator runs a whole
+ * frame in a burst and then sleeps, so the callback spreads each burst back
+ * out over time, mapping cycles to samples through the clock rate given to
+ * mixer_set_clock. The mapping is anchored on the first command and
+ * re-anchored whenever the two clocks drift more than a buffer apart.
+ */
+bool mixer_open(int rate, int channels, int frames);
+void mixer_close(void);
+bool mixer_load(int sound, const char *path);
+bool mixer_load_mem(int sound, const uint8_t *data, size_t size);
+void mixer_spec(int *rate, int *channels);
+unsigned long mixer_underruns(void);
+unsigned mixer_queue_depth(void);
+bool mixer_sample(int sound, const int16_t **pcm, int *frames);
+
+void mixer_set_clock(uint64_t cycles_per_second);
+bool mixer_command(MIXER_CMD type, int sound, uint64_t cycle);
+void mixer_apply(MixerVoice *voices, int *num_voices, MixerCommand cmd);
+void mixer_mix(MixerVoice *voices, int *num_voices, int16_t *out, int frames);
+
+#endif
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "options.h"
+#include "shmfb.h"
+#include "heatmap.h"
+
+static bool _parse_long(const char *arg, long *value) {
+    char *end;
+    *value = strtol(arg, &end, 10);
+    return *arg != '\0' && *end == '\0' && *value >= 0;
+}
+
+bool options_parse(Options *opts, int argc, char **argv) {
+    opts->capture_path = NULL;
+    opts->hash_log_path = NULL;
+    opts->trace_path = NULL;
+    opts->profile_path = NULL;
+    opts->profile_sample = 0;
+    opts->callgraph_path = NULL;
+    opts->symbols_path = NULL;
+    opts->sample_hz = 0;
+    opts->heatmap_prefix = NULL;
+    opts->heatmap_window = HEATMAP_WINDOW;
+    opts->heatmap_bytes = false;
+    opts->timeline_path = NULL;
+    opts->shm_name = NULL;
+    opts->shm_formats = SHMFB_VRAM | SHMFB_ARGB;
+    opts->stats_name = NULL;
+    opts->debug = false;
+    opts->hud = false;
+    opts->headless = false;
+    opts->speed = 1;
+    opts->frames = 0;
+    opts->latency_trials = 0;
+    opts->run_ahead = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (strcmp(arg, "--capture") == 0 && has_value) {
+            opts->capture_path = argv[++i];
+        } else if (strcmp(arg, "--hash-log") == 0 && has_value) {
+            opts->hash_log_path = argv[++i];
+        } else if (strcmp(arg, "--trace") == 0 && has_value) {
+            opts->trace_path = argv[++i];
+        } else if (strcmp(arg, "--profile") == 0 && has_value) {
+            opts->profile_path = argv[++i];
+        } else if (strcmp(arg, "--profile-sample") == 0 && has_value) {
+            long every;
+            if (!_parse_long(argv[++i], &every) || !every) {
+                fprintf(stderr, "Invalid sampling interval: %s\n", argv[i]);
+                return false;
+            }
+            opts->profile_sample = every;
+        } else if (strcmp(arg, "--callgraph") == 0 && has_value) {
+            opts->callgraph_path = argv[++i];
+        } else if (strcmp(arg, "--symbols") == 0 && has_value) {
+            opts->symbols_path = argv[++i];
+        } else if (strcmp(arg, "--sample") == 0 && has_value) {
+            if (!_parse_long(argv[++i], &opts->sample_hz) || !opts->sample_hz || opts->sample_hz > MAX_SAMPLE_HZ) {
+                fprintf(stderr, "Invalid sample rate: %s\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(arg, "--heatmap") == 0 && has_value) {
+            opts->heatmap_prefix = argv[++i];
+        } else if (strcmp(arg, "--heatmap-window") == 0 && has_value) {
+            if (!_parse_long(argv[++i], &opts->heatmap_window) || !opts->heatmap_window) {
+                fprintf(stderr, "Invalid heatmap window: %s\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(arg, "--heatmap-bytes") == 0) {
+            opts->heatmap_bytes = true;
+        } else if (strcmp(arg, "--timeline") == 0 && has_value) {
+            opts->timeline_path = argv[++i];
+        } else if (strcmp(arg, "--shm") == 0 && has_value) {
+            opts->shm_name = argv[++i];
+        } else if (strcmp(arg, "--shm-format") == 0 && has_value) {
+            const char *format = argv[++i];
+            if (strcmp(format, "vram") == 0) {
+                opts->shm_formats = SHMFB_VRAM;
+            } else if (strcmp(format, "argb") == 0) {
+                opts->shm_formats = SHMFB_ARGB;
+            } else if (strcmp(format, "both") == 0) {
+                opts->shm_formats = SHMFB_VRAM | SHMFB_ARGB;
+            } else {
+                fprintf(stderr, "Invalid shared memory format: %s\n", format);
+                return false;
+            }
+        } else if (strcmp(arg, "--stats") == 0 && has_value) {
+            opts->stats_name = argv[++i];
+        } else if (strcmp(arg, "--debug") == 0) {
+            opts->debug = true;
+        } else if (strcmp(arg, "--hud") == 0) {
+            opts->hud = true;
+        } else if (strcmp(arg, "--headless") == 0) {
+            opts->headless = true;
+        } else if (strcmp(arg, "--speed") == 0 && has_value) {
+            const char *speed = argv[++i];
+            char *end;
+            if (strcmp(speed, "max") == 0) {
+                opts->speed = 0;
+            } else if (!isfinite(opts->speed = strtod(speed, &end)) || opts->speed <= 0 || *end != '\0') {
+                fprintf(stderr, "Invalid speed: %s\n", speed);
+                return false;
+            }
+        } else if (strcmp(arg, "--frames") == 0 && has_value) {
+            if (!_parse_long(argv[++i], &opts->frames)) {
+                fprintf(stderr, "Invalid frame count: %s\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(arg, "--latency") == 0 && has_value) {
+            if (!_parse_long(argv[++i], &opts->latency_trials) || !opts->latency_trials) {
+                fprintf(stderr, "Invalid trial count: %s\n", argv[i]);
+                return false;
+            }
+        } else if (strcmp(arg, "--run-ahead") == 0 && has_value) {
+            if (!_parse_long(argv[++i], &opts->run_ahead) || opts->run_ahead > MAX_RUN_AHEAD) {
+                fprintf(stderr, "Invalid run-ahead frame count: %s\n", argv[i]);
+                return false;
+            }
+        } else {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", arg);
+            return false;
+        }
+    }
+
+    if (opts->symbols_path && !opts->callgraph_path) {
+        fprintf(stderr, "--symbols needs --callgraph\n");
+        return false;
+    }
+    if (opts->profile_sample && !opts->profile_path) {
+        fprintf(stderr, "--profile-sample needs --profile\n");
+        return false;
+    }
+    if (opts->heatmap_bytes && !opts->heatmap_prefix) {
+        fprintf(stderr, "--heatmap-bytes needs --heatmap\n");
+        return false;
+    }
+
+    return true;
+}
+
+void options_usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --capture PATH   Write every frame to PATH (Y4M, or raw RGB24 if PATH ends in .rgb)\n"
+            "                   and the sound track to PATH.wav\n"
+            "  --hash-log PATH  Log a hash of VRAM and RAM at every vblank, compare logs with invaders-hashcmp\n"
+            "  --trace PATH     Record every instruction to PATH, decode it with invaders-tracedump\n"
+            "  --profile PATH   Count instructions and cycles per opcode, report them at exit and\n"
+            "                   write them to PATH as CSV\n"
+            "  --profile-sample N  Also time one instruction in every N on the host clock\n"
+            "  --callgraph PATH Follow guest calls, report the heaviest routines at exit and write\n"
+            "                   folded stacks for flamegraph.pl to PATH\n"
+            "  --symbols PATH   Name routines in the call graph from ADDRESS NAME lines in PATH\n"
+            "  --sample HZ      Sample the guest PC and host phase HZ times a second (up to 10000)\n"
+            "                   and report the hottest ROM ranges at exit\n"
+            "  --heatmap PREFIX Count reads, writes and fetches of every byte (MEMORY_STATS builds),\n"
+            "                   write them to PREFIX.csv every window and PREFIX.ppm at exit\n"
+            "  --heatmap-window N  Frames per CSV window (default 60)\n"
+            "  --heatmap-bytes  One CSV row per touched byte instead of per 256-byte page\n"
+            "  --timeline PATH  Time every frame and phase on each thread and write them to PATH\n"
+            "                   as Chrome trace_event JSON for Perfetto\n"
+            "  --shm NAME       Publish every frame to the POSIX shared memory segment NAME\n"
+            "  --shm-format F   What to publish: vram, argb or both (default)\n"
+            "  --stats NAME     Publish live metrics to the POSIX shared memory segment NAME,\n"
+            "                   watch them with invaders-top NAME\n"
+            "  --debug          Start stopped in the debugger on the terminal, Ctrl-C stops again\n"
+            "  --hud            Start with the performance overlay shown (F2 toggles it)\n"
+            "  --headless       Run without a window and as fast as possible\n"
+            "  --speed N|max    Run at N times real time, or uncapped (F3 cycles speeds while running)\n"
+            "  --frames N       Quit after N frames\n"
+            "  --latency N      Play N input latency trials and report the distribution\n"
+            "  --run-ahead N    Show the game N frames ahead to hide its input lag (up to 8)\n",
+            program);
+}
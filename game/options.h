@@ -0,0 +1,37 @@
+#ifndef OPTIONS_H
+#define OPTIONS_H
+
+#include <stdbool.h>
+
+#define MAX_RUN_AHEAD 8
+#define MAX_SAMPLE_HZ 10000
+
+typedef struct Options {
+    const char *capture_path;   // Video capture file or pipe, NULL when off
+    const char *hash_log_path;  // Per-frame VRAM/RAM hash log, NULL when off
+    const char *trace_path;     // Binary instruction trace, NULL when off
+    const char *profile_path;   // Per-opcode profile CSV, NULL when off
+    unsigned long profile_sample; // Time one instruction in this many, 0 to only count
+    const char *callgraph_path; // Folded call stacks for flamegraph.pl, NULL when off
+    const char *symbols_path;   // Names for ROM routines, NULL for none
+    long sample_hz;             // Guest PC samples a second, 0 when off
+    const char *heatmap_prefix; // Memory access CSV and image, NULL when off
+    long heatmap_window;        // Frames per heatmap CSV window
+    bool heatmap_bytes;         // Heatmap CSV rows per byte rather than per page
+    const char *timeline_path;  // Chrome trace_event JSON of host phases, NULL when off
+    const char *shm_name;       // Shared-memory framebuffer export, NULL when off
+    unsigned shm_formats;       // SHMFB_FORMAT bits to publish
+    const char *stats_name;     // Shared-memory live metrics, NULL when off
+    bool debug;                 // Start stopped in the debugger, Ctrl-C stops again
+    bool hud;                   // Start with the performance overlay shown
+    bool headless;              // No window and no frame pacing
+    double speed;               // Multiple of real time, 0 for uncapped
+    long frames;                // Stop after this many frames, 0 to run forever
+    long latency_trials;        // Input latency trials to run, 0 when off
+    long run_ahead;             // Frames shown ahead of the real game state
+} Options;
+
+bool options_parse(Options *opts, int argc, char **argv);
+void options_usage(const char *program);
+
+#endif
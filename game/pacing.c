@@ -0,0 +1,137 @@
+#include <math.h>
+#include <SDL2/SDL.h>
+#include "hardware.h"
+#include "pacing.h"
+
+#define NS_PER_SEC 1000000000ULL
+
+// Monotonic clock in nanoseconds
+uint64_t pacing_now_ns(void) {
+    static uint64_t freq = 0;
+    if (!freq) {
+        freq = SDL_GetPerformanceFrequency();
+    }
+
+    // Split to keep the multiply from overflowing on long uptimes
+    uint64_t count = SDL_GetPerformanceCounter();
+    return (count / freq) * NS_PER_SEC + ((count % freq) * NS_PER_SEC) / freq;
+}
+
+static double _period_ns(const Pacer *p) {
+    return (double)NS_PER_SEC / (REFRESH_RATE * p->speed);
+}
+
+static uint64_t _deadline(const Pacer *p) {
+    return p->start + (uint64_t)(p->frame * _period_ns(p));
+}
+
+// Coarse sleep first, then spin for the precise wakeup
+uint64_t pacing_sleep_until(uint64_t deadline) {
+    uint64_t now = pacing_now_ns();
+
+    if (now < deadline && deadline - now > PACING_SPIN_NS) {
+        SDL_Delay((deadline - now - PACING_SPIN_NS) / 1000000);
+    }
+    while ((now = pacing_now_ns()) < deadline) {
+    }
+
+    return now;
+}
+
+void pacing_init(Pacer *p, double speed) {
+    p->speed = speed;
+    p->start = pacing_now_ns();
+    p->last_render = 0;
+    p->frame = 1;
+    p->last_end = p->start;
+    p->skip_run = 0;
+    p->behind = false;
+    p->sum_sq = 0;
+
+    p->stats = (PacingStats){ .min_ns = UINT64_MAX };
+}
+
+// Starts a fresh schedule at the new speed from the end of the last frame
+void pacing_set_speed(Pacer *p, double speed) {
+    p->speed = speed;
+    p->start = p->last_end;
+    p->frame = 1;
+    p->behind = false;
+}
+
+// Whether the frame about to be emulated should be drawn
+bool pacing_render_due(Pacer *p) {
+    if (p->speed != 1) {
+        // Off real time, draw at most at the display rate
+        uint64_t now = pacing_now_ns();
+        if (now - p->last_render < NS_PER_SEC / REFRESH_RATE) {
+            p->stats.skipped++;
+            return false;
+        }
+        p->last_render = now;
+        return true;
+    }
+
+    if (p->behind && p->skip_run < PACING_MAX_SKIP) {
+        p->skip_run++;
+        p->stats.skipped++;
+        return false;
+    }
+
+    p->skip_run = 0;
+    return true;
+}
+
+// Sleeps until the mid-screen point of the current frame, so each half of
+// the screen goes out in its own half of the refresh period
+void pacing_wait_half(Pacer *p) {
+    if (p->speed && !p->behind) {
+        pacing_sleep_until(_deadline(p) - (uint64_t)(_period_ns(p) / 2));
+    }
+}
+
+// Sleeps until the current frame's deadline, then schedules the next one
+void pacing_wait(Pacer *p) {
+    uint64_t now = pacing_now_ns();
+
+    // Uncapped runs skip all of this and start the next frame right away
+    if (p->speed) {
+        uint64_t deadline = _deadline(p);
+
+        p->behind = now > deadline;
+        if (p->behind) {
+            p->stats.late++;
+
+            if (now - deadline > PACING_RESYNC_FRAMES * _period_ns(p)) {
+                // Too far behind to ever catch up (a stall, a debugger), start over
+                p->start = now;
+                p->frame = 0;
+                p->behind = false;
+                p->stats.resyncs++;
+            }
+        } else {
+            now = pacing_sleep_until(deadline);
+        }
+    }
+
+    uint64_t frame_ns = now - p->last_end;
+    p->last_end = now;
+    p->frame++;
+
+    p->stats.frames++;
+    p->stats.min_ns = frame_ns < p->stats.min_ns ? frame_ns : p->stats.min_ns;
+    p->stats.max_ns = frame_ns > p->stats.max_ns ? frame_ns : p->stats.max_ns;
+    p->stats.mean_ns += (frame_ns - p->stats.mean_ns) / p->stats.frames;
+    p->sum_sq += (double)frame_ns * frame_ns;
+}
+
+void pacing_stats(const Pacer *p, PacingStats *stats) {
+    *stats = p->stats;
+
+    if (stats->frames) {
+        double variance = p->sum_sq / stats->frames - stats->mean_ns * stats->mean_ns;
+        stats->jitter_ns = variance > 0 ? sqrt(variance) : 0;
+    } else {
+        stats->min_ns = 0;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef PACING_H
+#define PACING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PACING_SPIN_NS 500000           // Busy-wait the last stretch before a deadline
+#define PACING_MAX_SKIP 4               // Most frames in a row left undrawn when behind
+#define PACING_RESYNC_FRAMES 8          // Give up catching up when this far behind
+
+typedef struct PacingStats {
+    uint64_t frames;
+    uint64_t late;                      // Frames that finished after their deadline
+    uint64_t skipped;                   // Frames emulated without being drawn
+    uint64_t resyncs;                   // Times the schedule was reset after a stall
+    uint64_t min_ns;
+    uint64_t max_ns;
+    double mean_ns;
+    double jitter_ns;                   // Standard deviation of the frame time
+} PacingStats;
+
+/* Keeps frames on an absolute schedule of start + n * period, so the error of
+ * one frame never carries into the next. When the host falls behind, frames
+ * are still emulated at full count but their rendering is skipped. At any
+ * speed other than real time, drawing is decimated to the display rate.
+ */
+typedef struct Pacer {
+    double speed;                       // Multiple of real time, 0 for uncapped
+    uint64_t last_render;
+    uint64_t start;
+    uint64_t frame;
+    uint64_t last_end;
+    int skip_run;
+    bool behind;
+
+    PacingStats stats;
+    double sum_sq;
+} Pacer;
+
+uint64_t pacing_now_ns(void);
+uint64_t pacing_sleep_until(uint64_t deadline);
+void pacing_init(Pacer *pacer, double speed);
+void pacing_set_speed(Pacer *pacer, double speed);
+bool pacing_render_due(Pacer *pacer);
+void pacing_wait_half(Pacer *pacer);
+void pacing_wait(Pacer *pacer);
+void pacing_stats(const Pacer *pacer, PacingStats *stats);
+
+#endif
@@ -0,0 +1,29 @@
+#include "phase.h"
+#include "timeline.h"
+
+volatile sig_atomic_t host_phase = PHASE_OTHER;
+
+const char *const phase_names[NUM_PHASES] = {
+    "other", "cpu", "render", "input", "sleep"
+};
+
+bool phase_timed = false;
+uint64_t phase_ns[NUM_PHASES];
+
+static uint64_t phase_started = 0;
+
+// Closes the span of the phase being left
+void phase_span(HOST_PHASE next) {
+    if ((sig_atomic_t)next == host_phase && phase_started) {
+        return;
+    }
+
+    uint64_t now = pacing_now_ns();
+    if (phase_started) {
+        phase_ns[host_phase] += now - phase_started;
+        if (atomic_load_explicit(&timeline_on, memory_order_relaxed)) {
+            timeline_record(phase_names[host_phase], phase_started, now, -1);
+        }
+    }
+    phase_started = now;
+}
@@ -0,0 +1,38 @@
+#ifndef PHASE_H
+#define PHASE_H
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* What the main thread is doing, kept up to date by the frame loop so
+ * profilers can attribute host time without timing every step themselves.
+ */
+typedef enum {
+    PHASE_OTHER,                        // Startup, shutdown and anything unmarked
+    PHASE_CPU,                          // Emulating instructions
+    PHASE_RENDER,                       // Handing the frame to the display, captures and exports
+    PHASE_INPUT,
+    PHASE_SLEEP,                        // Waiting for the frame deadline
+    NUM_PHASES
+} HOST_PHASE;
+
+// Written only by the main thread, and safe to read from a signal handler on it
+extern volatile sig_atomic_t host_phase;
+extern const char *const phase_names[NUM_PHASES];
+
+// Set before the frame loop to total the time in each phase into phase_ns
+// and to put each phase on the timeline, if that is open
+extern bool phase_timed;
+extern uint64_t phase_ns[NUM_PHASES];
+
+void phase_span(HOST_PHASE next);
+
+static inline void phase_enter(HOST_PHASE phase) {
+    if (phase_timed) {
+        phase_span(phase);
+    }
+    host_phase = phase;
+}
+
+#endif
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "profile.h"
+
+#define CLOCK_CALIBRATION_READS 1000
+#define REPORT_OPCODES 20               // Rows in the printed report, the CSV has them all
+
+static const char *const class_names[NUM_PROFILE_CLASSES] = {
+    "register", "memory", "branch", "I/O"
+};
+
+static PROFILE_CLASS _class_of(uint8_t opcode) {
+    unsigned kind = opcode_info[opcode].kind;
+
+    if (kind & OP_IO) {
+        return PROFILE_IO;
+    }
+    if (kind & OP_BRANCH) {
+        return PROFILE_BRANCH;
+    }
+    if (kind & (OP_MEM_READ | OP_MEM_WRITE)) {
+        return PROFILE_MEMORY;
+    }
+    return PROFILE_REGISTER;
+}
+
+// The disassembly text without its operand, e.g. "MVI B" or "JMP"
+static void _mnemonic(uint8_t opcode, char *out, size_t size) {
+    const char *text = opcode_text[opcode];
+    size_t n = 0;
+
+    for (; *text && *text != '%' && n + 1 < size; text++) {
+        if (*text != ' ' || (n && out[n - 1] != ' ')) {
+            out[n++] = *text;
+        }
+    }
+    while (n && strchr(" ,#$", out[n - 1])) {
+        n--;
+    }
+    out[n] = '\0';
+}
+
+void profile_init(OpcodeProfile *p, unsigned long sample_every) {
+    memset(p, 0, sizeof(*p));
+    p->sample_every = sample_every;
+    p->countdown = sample_every;
+
+    if (sample_every) {
+        uint64_t start = pacing_now_ns();
+        for (int i = 0; i < CLOCK_CALIBRATION_READS; i++) {
+            pacing_now_ns();
+        }
+        p->clock_ns = (pacing_now_ns() - start) / CLOCK_CALIBRATION_READS;
+    }
+}
+
+void profile_sample(OpcodeProfile *p, State8080 *state, uint8_t opcode) {
+    uint64_t start = pacing_now_ns();
+    Emulate8080Op(state);
+    uint64_t ns = pacing_now_ns() - start;
+
+    p->countdown = p->sample_every;
+    p->samples[opcode]++;
+    p->sample_ns[opcode] += ns > p->clock_ns ? ns - p->clock_ns : 0;
+}
+
+static const OpcodeProfile *sort_profile;
+
+static int _by_cycles(const void *a, const void *b) {
+    uint64_t x = sort_profile->cycles[*(const uint8_t *)a];
+    uint64_t y = sort_profile->cycles[*(const uint8_t *)b];
+    return (x < y) - (x > y);
+}
+
+void profile_report(const OpcodeProfile *p) {
+    uint8_t order[NUM_OPCODES];
+    uint64_t total_count = 0, total_cycles = 0;
+    uint64_t class_samples[NUM_PROFILE_CLASSES] = { 0 };
+    uint64_t class_ns[NUM_PROFILE_CLASSES] = { 0 };
+
+    for (int i = 0; i < NUM_OPCODES; i++) {
+        order[i] = i;
+        total_count += p->count[i];
+        total_cycles += p->cycles[i];
+        class_samples[_class_of(i)] += p->samples[i];
+        class_ns[_class_of(i)] += p->sample_ns[i];
+    }
+    if (!total_count) {
+        return;
+    }
+
+    sort_profile = p;
+    qsort(order, NUM_OPCODES, 1, _by_cycles);
+
+    printf("Opcode profile: %llu instructions, %llu cycles\n",
+           (unsigned long long)total_count, (unsigned long long)total_cycles);
+    printf("  op  mnemonic          count      %%       cycles      %%\n");
+    for (int i = 0; i < REPORT_OPCODES && p->count[order[i]]; i++) {
+        uint8_t op = order[i];
+        char name[16];
+
+        _mnemonic(op, name, sizeof(name));
+        printf("  %02x  %-10s %12llu %5.1f%% %12llu %5.1f%%\n", op, name,
+               (unsigned long long)p->count[op], 100.0 * p->count[op] / total_count,
+               (unsigned long long)p->cycles[op], 100.0 * p->cycles[op] / total_cycles);
+    }
+
+    if (!p->sample_every) {
+        return;
+    }
+    printf("Host time per instruction, clock overhead of %llu ns removed:\n", (unsigned long long)p->clock_ns);
+    for (int c = 0; c < NUM_PROFILE_CLASSES; c++) {
+        if (class_samples[c]) {
+            printf("  %-8s %8.1f ns over %llu samples\n", class_names[c],
+                   (double)class_ns[c] / class_samples[c], (unsigned long long)class_samples[c]);
+        }
+    }
+}
+
+bool profile_write_csv(const OpcodeProfile *p, const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "opcode,mnemonic,class,count,cycles,samples,mean_ns\n");
+    for (int op = 0; op < NUM_OPCODES; op++) {
+        char name[16];
+
+        _mnemonic(op, name, sizeof(name));
+        fprintf(file, "0x%02x,\"%s\",%s,%llu,%llu,%llu,%.1f\n", op, name, class_names[_class_of(op)],
+                (unsigned long long)p->count[op], (unsigned long long)p->cycles[op],
+                (unsigned long long)p->samples[op],
+                p->samples[op] ? (double)p->sample_ns[op] / p->samples[op] : 0.0);
+    }
+
+    return fclose(file) == 0;
+}
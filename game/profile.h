@@ -0,0 +1,52 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "emu8080.h"
+#include "pacing.h"
+
+typedef enum {
+    PROFILE_REGISTER,                   // Registers and flags only
+    PROFILE_MEMORY,
+    PROFILE_BRANCH,
+    PROFILE_IO,
+    NUM_PROFILE_CLASSES
+} PROFILE_CLASS;
+
+/* Counts every instruction and the cycles it took, taken branches included.
+ * When sampling, one instruction in every sample_every is also timed on the
+ * host clock, less the cost of reading the clock itself.
+ */
+typedef struct OpcodeProfile {
+    uint64_t count[NUM_OPCODES];
+    uint64_t cycles[NUM_OPCODES];
+    uint64_t samples[NUM_OPCODES];
+    uint64_t sample_ns[NUM_OPCODES];
+
+    unsigned long sample_every;         // 0 when not timing
+    unsigned long countdown;
+    uint64_t clock_ns;                  // Measured overhead of a pair of clock reads
+} OpcodeProfile;
+
+void profile_init(OpcodeProfile *profile, unsigned long sample_every);
+void profile_report(const OpcodeProfile *profile);
+bool profile_write_csv(const OpcodeProfile *profile, const char *path);
+
+void profile_sample(OpcodeProfile *profile, State8080 *state, uint8_t opcode);
+
+// Runs one instruction, the next opcode as NextOpcode8080 gave it, and counts it
+static inline void profile_step(OpcodeProfile *p, State8080 *state, uint8_t opcode) {
+    unsigned long long before = state->cycles;
+
+    if (p->sample_every && --p->countdown == 0) {
+        profile_sample(p, state, opcode);
+    } else {
+        Emulate8080Op(state);
+    }
+
+    p->count[opcode]++;
+    p->cycles[opcode] += state->cycles - before;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#include <string.h>
+#include "render.h"
+#include "timeline.h"
+
+static int _render_thread(void *data) {
+    Renderer *r = data;
+
+    timeline_name_thread("render");
+    while (atomic_load(&r->running)) {
+        SDL_SemWaitTimeout(r->ready, 100);
+
+        if (!(atomic_load(&r->middle) & RENDER_FRESH)) {
+            continue;
+        }
+
+        // Trade the frame we last drew for the newest complete one
+        r->front = atomic_exchange(&r->middle, r->front) & RENDER_INDEX;
+        FrameSlot *slot = &r->slots[r->front];
+
+        // Only the half the beam just finished is drawn, unless the other
+        // half was dropped in the meantime and the screen needs catching up,
+        // or the frame came whole
+        int first = 0;
+        int last = DISP_BYTES;
+        if (slot->half != RENDER_FULL && slot->seq == r->drawn_seq + 1) {
+            first = (slot->half == RENDER_TOP_HALF) ? 0 : DISP_BYTES / 2;
+            last = first + DISP_BYTES / 2;
+        }
+        r->drawn_seq = slot->seq;
+
+        uint64_t started = timeline_begin();
+        display_draw(r->window, r->surface, slot->vram, first, last, slot->show_hud ? &slot->hud : NULL);
+        timeline_end("draw", started);
+
+        if (SDL_GetPerformanceCounter() - slot->published > r->late_ticks) {
+            atomic_fetch_add(&r->late, 1);
+        }
+        atomic_fetch_add(&r->presented, 1);
+    }
+
+    return 0;
+}
+
+bool render_init(Renderer *r, SDL_Window *window, SDL_Surface *surface) {
+    memset(r->slots, 0, sizeof(r->slots));
+    r->window = window;
+    r->surface = surface;
+    r->back = 0;
+    r->front = 1;
+    atomic_init(&r->middle, 2);
+    atomic_init(&r->running, true);
+    atomic_init(&r->presented, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_init(&r->late, 0);
+    r->seq = 0;
+    r->drawn_seq = 0;
+    r->late_ticks = SDL_GetPerformanceFrequency() / (REFRESH_RATE * 2);
+
+    r->ready = SDL_CreateSemaphore(0);
+    if (!r->ready) {
+        return false;
+    }
+
+    r->thread = SDL_CreateThread(_render_thread, "render", r);
+    if (!r->thread) {
+        SDL_DestroySemaphore(r->ready);
+        return false;
+    }
+
+    return true;
+}
+
+// Called by the emulator at mid-screen and at vblank, with the overlay text
+// or NULL to show none. Never blocks on the render thread.
+void render_publish(Renderer *r, const uint8_t *vram, RENDER_HALF half, const HudText *hud) {
+    FrameSlot *slot = &r->slots[r->back];
+
+    memcpy(slot->vram, vram, DISP_BYTES);
+    slot->show_hud = hud != NULL;
+    if (hud) {
+        slot->hud = *hud;
+    }
+    slot->half = half;
+    slot->seq = ++r->seq;
+    slot->published = SDL_GetPerformanceCounter();
+
+    int prev = atomic_exchange(&r->middle, r->back | RENDER_FRESH);
+    if (prev & RENDER_FRESH) {
+        // The render thread never picked up the previous half
+        atomic_fetch_add(&r->dropped, 1);
+    }
+    r->back = prev & RENDER_INDEX;
+
+    SDL_SemPost(r->ready);
+}
+
+void render_quit(Renderer *r) {
+    atomic_store(&r->running, false);
+    SDL_SemPost(r->ready);
+    SDL_WaitThread(r->thread, NULL);
+    SDL_DestroySemaphore(r->ready);
+}
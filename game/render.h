@@ -0,0 +1,63 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
+#include "hardware.h"
+
+#define RENDER_BUFFERS 3
+#define RENDER_FRESH 0x4        // Set on the shared index when it holds an unseen frame
+#define RENDER_INDEX 0x3
+
+/* The raster is published in two halves: the top half once the beam has
+ * passed mid-screen (RST 1) and the bottom half at vblank (RST 2). A frame
+ * computed all at once, as run-ahead does, goes out whole.
+ */
+typedef enum {
+    RENDER_TOP_HALF,
+    RENDER_BOTTOM_HALF,
+    RENDER_FULL
+} RENDER_HALF;
+
+typedef struct FrameSlot {
+    uint8_t vram[DISP_BYTES];
+    RENDER_HALF half;
+    uint64_t seq;
+    uint64_t published;         // Performance counter value at publish time
+    bool show_hud;
+    HudText hud;
+} FrameSlot;
+
+/* Triple buffered VRAM handoff between the emulator (producer) and the
+ * render thread (consumer). The producer owns `back`, the consumer owns
+ * `front` and the third buffer is parked in `middle`; both sides only ever
+ * swap their own buffer with the parked one, so neither side takes a lock.
+ */
+typedef struct Renderer {
+    SDL_Window *window;
+    SDL_Surface *surface;
+    SDL_Thread *thread;
+    SDL_sem *ready;
+
+    FrameSlot slots[RENDER_BUFFERS];
+    int back;
+    int front;
+    atomic_int middle;
+    atomic_bool running;
+
+    uint64_t seq;
+    uint64_t drawn_seq;         // Consumer side, last slot sequence drawn
+    uint64_t late_ticks;        // A half older than this when presented is late
+
+    atomic_ulong presented;
+    atomic_ulong dropped;
+    atomic_ulong late;
+} Renderer;
+
+bool render_init(Renderer *renderer, SDL_Window *window, SDL_Surface *surface);
+void render_publish(Renderer *renderer, const uint8_t *vram, RENDER_HALF half, const HudText *hud);
+void render_quit(Renderer *renderer);
+
+#endif
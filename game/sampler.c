@@ -0,0 +1,196 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "sampler.h"
+#include "phase.h"
+#include "hardware.h"
+#include "disasm8080.h"
+
+typedef struct PcRange {
+    uint16_t first;
+    uint16_t last;
+    uint32_t samples;
+} PcRange;
+
+/* The timer signal can land on any thread, so the handler passes it on to
+ * the main thread and only counts there. Counters are plain integers since
+ * nothing else writes them and they are only read after the timer stops.
+ */
+static struct {
+    const volatile State8080 *state;
+    pthread_t main_thread;
+    bool running;
+    long period_us;
+    uint32_t seed;
+    uint32_t pc[MAX_MEM];
+    uint32_t phases[NUM_PHASES];
+    uint32_t total;
+} sampler;
+
+/* A fixed period would line up with the frame schedule and see the same few
+ * moments of every frame, so each wait is drawn from half to one and a half
+ * periods. */
+static void _arm(void) {
+    struct itimerval timer = { { 0, 0 }, { 0, 0 } };
+    uint32_t x = sampler.seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sampler.seed = x;
+
+    long us = sampler.period_us / 2 + x % sampler.period_us + 1;
+    timer.it_value.tv_sec = us / 1000000;
+    timer.it_value.tv_usec = us % 1000000;
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+static void _on_timer(int signal) {
+    int saved_errno = errno;
+
+    if (!pthread_equal(pthread_self(), sampler.main_thread)) {
+        pthread_kill(sampler.main_thread, signal);
+    } else {
+        HOST_PHASE phase = host_phase;
+        sampler.phases[phase]++;
+        sampler.total++;
+        if (phase == PHASE_CPU) {
+            sampler.pc[sampler.state->pc]++;
+        }
+        _arm();
+    }
+
+    errno = saved_errno;
+}
+
+// Samples on wall-clock time, so waiting shows up as well as work
+bool sampler_start(const State8080 *state, long hz) {
+    struct sigaction action;
+
+    memset(&sampler, 0, sizeof(sampler));
+    sampler.state = state;
+    sampler.main_thread = pthread_self();
+    sampler.period_us = 1000000 / hz;
+    sampler.seed = 0x9e3779b9;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = _on_timer;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGALRM, &action, NULL) < 0) {
+        return false;
+    }
+
+    sampler.running = true;
+    _arm();
+    return true;
+}
+
+void sampler_stop(void) {
+    struct itimerval timer = { { 0, 0 }, { 0, 0 } };
+
+    if (!sampler.running) {
+        return;
+    }
+    signal(SIGALRM, SIG_IGN);
+    setitimer(ITIMER_REAL, &timer, NULL);
+    sampler.running = false;
+}
+
+static int _by_samples(const void *a, const void *b) {
+    uint32_t x = ((const PcRange *)a)->samples;
+    uint32_t y = ((const PcRange *)b)->samples;
+    return (x < y) - (x > y);
+}
+
+// Reset and the two interrupts the video hardware raises
+static const uint16_t rom_entries[] = { 0x0000, 0x0008, 0x0010 };
+
+// Lists a range with the samples that landed on each instruction. Ranges in
+// the traced ROM get its labels and the name of the routine they are in.
+static void _print_range(const uint8_t *memory, const Disassembly *dis, const PcRange *range, uint32_t cpu_samples) {
+    const Disassembly *rom = range->first < RAM_START ? dis : NULL;
+    char routine[DISASM_LABEL_TEXT] = "";
+    char label[DISASM_LABEL_TEXT];
+    char text[DISASM_TEXT + DISASM_LABEL_TEXT];
+
+    // The nearest subroutine entry at or before the range
+    for (int pc = range->first; rom && pc >= 0; pc--) {
+        if (rom->marks[pc] & DISASM_CALL) {
+            Label8080(rom, pc, routine, sizeof(routine));
+            break;
+        }
+    }
+
+    printf("  %04x-%04x%s%s: %u samples, %.1f%% of emulation\n", range->first, range->last,
+           routine[0] ? " in " : "", routine, range->samples, 100.0 * range->samples / cpu_samples);
+
+    int pc = range->first;
+    for (int line = 0; pc <= range->last && line < SAMPLER_REPORT_LINES; line++) {
+        int size;
+        if (rom) {
+            if (Label8080(rom, pc, label, sizeof(label))) {
+                printf("            %s:\n", label);
+            }
+            size = FormatLabeled8080(rom, pc, text, sizeof(text));
+        } else {
+            size = Format8080Op(memory, pc, text, sizeof(text));
+        }
+        printf("    %6u  %04x %s\n", sampler.pc[pc], pc, text);
+        pc += size;
+    }
+    if (pc <= range->last) {
+        printf("    ...\n");
+    }
+}
+
+void sampler_report(const uint8_t *memory) {
+    uint32_t cpu_samples = sampler.phases[PHASE_CPU];
+
+    printf("PC samples: %u,", sampler.total);
+    for (int i = 0; i < NUM_PHASES; i++) {
+        printf(" %s %.1f%%", phase_names[i], sampler.total ? 100.0 * sampler.phases[i] / sampler.total : 0.0);
+    }
+    printf("\n");
+    if (!cpu_samples) {
+        return;
+    }
+
+    // Runs of sampled PCs with small gaps make up the hot ranges
+    PcRange *ranges = malloc(MAX_MEM * sizeof(PcRange));
+    int num_ranges = 0;
+    if (!ranges) {
+        return;
+    }
+    for (int pc = 0; pc < MAX_MEM; pc++) {
+        if (!sampler.pc[pc]) {
+            continue;
+        }
+        if (num_ranges && pc - ranges[num_ranges - 1].last <= SAMPLER_RANGE_GAP) {
+            ranges[num_ranges - 1].last = pc;
+        } else {
+            ranges[num_ranges].first = ranges[num_ranges].last = pc;
+            ranges[num_ranges].samples = 0;
+            num_ranges++;
+        }
+        ranges[num_ranges - 1].samples += sampler.pc[pc];
+    }
+
+    // Tracing the ROM takes well under a millisecond, so it is redone every report
+    static Disassembly dis;
+    bool traced = DisassembleImage8080(&dis, memory, 0, RAM_START, rom_entries,
+                                       sizeof(rom_entries) / sizeof(rom_entries[0]));
+
+    qsort(ranges, num_ranges, sizeof(PcRange), _by_samples);
+    for (int i = 0; i < num_ranges && i < SAMPLER_REPORT_RANGES; i++) {
+        _print_range(memory, traced ? &dis : NULL, &ranges[i], cpu_samples);
+    }
+    if (traced) {
+        FreeDisassembly8080(&dis);
+    }
+    free(ranges);
+}
@@ -0,0 +1,16 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "emu8080.h"
+
+#define SAMPLER_RANGE_GAP 3             // Sampled PCs this close belong to the same range
+#define SAMPLER_REPORT_RANGES 8
+#define SAMPLER_REPORT_LINES 24         // Instructions listed per range
+
+bool sampler_start(const State8080 *state, long hz);
+void sampler_stop(void);
+void sampler_report(const uint8_t *memory);
+
+#endif
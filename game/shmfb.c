@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "hardware.h"
+#include "shmfb.h"
+
+_Static_assert(SHMFB_WIDTH == DISP_WIDTH && SHMFB_HEIGHT == DISP_HEIGHT, "shared framebuffer size");
+_Static_assert(SHMFB_VRAM_BYTES == DISP_BYTES, "shared VRAM size");
+
+bool shmfb_open(ShmExport *shm, const char *name, uint32_t formats) {
+    shm->fb = NULL;
+    shm->frame = 0;
+
+    // POSIX wants a single leading slash
+    shm->name = malloc(strlen(name) + 2);
+    if (!shm->name) {
+        return false;
+    }
+    sprintf(shm->name, "%s%s", name[0] == '/' ? "" : "/", name);
+
+    int fd = shm_open(shm->name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        free(shm->name);
+        return false;
+    }
+
+    if (ftruncate(fd, sizeof(ShmFrameBuffer)) < 0) {
+        close(fd);
+        shm_unlink(shm->name);
+        free(shm->name);
+        return false;
+    }
+
+    void *map = mmap(NULL, sizeof(ShmFrameBuffer), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(shm->name);
+        free(shm->name);
+        return false;
+    }
+
+    shm->fb = map;
+    memset(shm->fb, 0, sizeof(ShmFrameBuffer));
+    shm->fb->width = SHMFB_WIDTH;
+    shm->fb->height = SHMFB_HEIGHT;
+    shm->fb->slot_count = SHMFB_SLOTS;
+    shm->fb->formats = formats;
+    shm->fb->version = SHMFB_VERSION;
+
+    // Readers check the magic last, so it goes in once everything else is set
+    atomic_thread_fence(memory_order_release);
+    shm->fb->magic = SHMFB_MAGIC;
+    return true;
+}
+
+// Called by the emulator at vblank with the finished frame
+void shmfb_publish(ShmExport *shm, const uint8_t *vram) {
+    uint64_t frame = ++shm->frame;
+    ShmFrameSlot *slot = &shm->fb->slots[frame % SHMFB_SLOTS];
+    unsigned seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    // Odd sequence marks the slot as being written
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->frame = frame;
+    if (shm->fb->formats & SHMFB_VRAM) {
+        memcpy(slot->vram, vram, DISP_BYTES);
+    }
+    if (shm->fb->formats & SHMFB_ARGB) {
+        display_rasterize(slot->argb, vram);
+    }
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&shm->fb->frame, frame, memory_order_release);
+}
+
+void shmfb_close(ShmExport *shm) {
+    if (shm->fb) {
+        munmap(shm->fb, sizeof(ShmFrameBuffer));
+        shm_unlink(shm->name);
+    }
+    free(shm->name);
+}
@@ -0,0 +1,59 @@
+#ifndef SHMFB_H
+#define SHMFB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Layout of the shared-memory framebuffer published with --shm NAME.
+ * This header is self-contained so external tools can include it as is.
+ *
+ * Readers shm_open(NAME, O_RDONLY) and mmap the segment, then for each frame:
+ *   1. load `frame`; the newest frame sits in slots[frame % SHMFB_SLOTS]
+ *   2. load the slot's `seq`, retry if it is odd (the writer is inside)
+ *   3. use the pixels in place
+ *   4. load `seq` again, the data was consistent only if it is unchanged
+ * The emulator never waits for readers.
+ */
+#define SHMFB_MAGIC 0x42464953      // "SIFB"
+#define SHMFB_VERSION 1
+#define SHMFB_SLOTS 4
+#define SHMFB_WIDTH 224
+#define SHMFB_HEIGHT 256
+#define SHMFB_VRAM_BYTES (SHMFB_WIDTH * SHMFB_HEIGHT / 8)
+
+typedef enum {
+    SHMFB_VRAM = 1,                 // Native 1bpp VRAM, 32 bytes per raster line
+    SHMFB_ARGB = (1 << 1)           // Rotated and coloured screen, opaque, SHMFB_WIDTH pixels per row
+} SHMFB_FORMAT;
+
+typedef struct ShmFrameSlot {
+    atomic_uint seq;
+    uint32_t reserved;
+    uint64_t frame;
+    uint8_t vram[SHMFB_VRAM_BYTES];
+    uint32_t argb[SHMFB_WIDTH * SHMFB_HEIGHT];
+} ShmFrameSlot;
+
+typedef struct ShmFrameBuffer {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t slot_count;
+    uint32_t formats;               // SHMFB_FORMAT bits that are filled in
+    atomic_ullong frame;            // Newest complete frame, 0 before the first
+    ShmFrameSlot slots[SHMFB_SLOTS];
+} ShmFrameBuffer;
+
+typedef struct ShmExport {
+    ShmFrameBuffer *fb;
+    char *name;
+    uint64_t frame;
+} ShmExport;
+
+bool shmfb_open(ShmExport *shm, const char *name, uint32_t formats);
+void shmfb_publish(ShmExport *shm, const uint8_t *vram);
+void shmfb_close(ShmExport *shm);
+
+#endif
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "pacing.h"
+#include "shmstats.h"
+
+bool shmstats_open(ShmStatsExport *shm, const char *name, const char *const *phase_names, int phase_count) {
+    shm->stats = NULL;
+    shm->started = pacing_now_ns();
+
+    // POSIX wants a single leading slash
+    shm->name = malloc(strlen(name) + 2);
+    if (!shm->name || phase_count > SHMSTATS_PHASES) {
+        free(shm->name);
+        return false;
+    }
+    sprintf(shm->name, "%s%s", name[0] == '/' ? "" : "/", name);
+
+    int fd = shm_open(shm->name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        free(shm->name);
+        return false;
+    }
+
+    if (ftruncate(fd, sizeof(ShmStats)) < 0) {
+        close(fd);
+        shm_unlink(shm->name);
+        free(shm->name);
+        return false;
+    }
+
+    void *map = mmap(NULL, sizeof(ShmStats), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        shm_unlink(shm->name);
+        free(shm->name);
+        return false;
+    }
+
+    shm->stats = map;
+    memset(shm->stats, 0, sizeof(ShmStats));
+    shm->stats->version = SHMSTATS_VERSION;
+    shm->stats->size = sizeof(ShmStats);
+    shm->stats->pid = getpid();
+    shm->stats->phase_count = phase_count;
+    for (int i = 0; i < phase_count; i++) {
+        strncpy(shm->stats->phase_names[i], phase_names[i], SHMSTATS_NAME_BYTES - 1);
+    }
+    atomic_store_explicit(&shm->stats->state, SHMSTATS_RUNNING, memory_order_relaxed);
+
+    // Readers check the magic last, so it goes in once everything else is set
+    atomic_thread_fence(memory_order_release);
+    shm->stats->magic = SHMSTATS_MAGIC;
+    return true;
+}
+
+// Called once a frame, never waits for readers
+void shmstats_publish(ShmStatsExport *shm, const StatsSample *sample) {
+    ShmStats *s = shm->stats;
+
+    atomic_store_explicit(&s->frames, sample->frames, memory_order_relaxed);
+    atomic_store_explicit(&s->instructions, sample->instructions, memory_order_relaxed);
+    atomic_store_explicit(&s->cycles, sample->cycles, memory_order_relaxed);
+    atomic_store_explicit(&s->late_frames, sample->late_frames, memory_order_relaxed);
+    atomic_store_explicit(&s->skipped_frames, sample->skipped_frames, memory_order_relaxed);
+    atomic_store_explicit(&s->dropped_halves, sample->dropped_halves, memory_order_relaxed);
+    atomic_store_explicit(&s->audio_underruns, sample->audio_underruns, memory_order_relaxed);
+    for (uint32_t i = 0; i < s->phase_count; i++) {
+        atomic_store_explicit(&s->phase_ns[i], sample->phase_ns[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&s->uptime_ns, pacing_now_ns() - shm->started, memory_order_relaxed);
+}
+
+void shmstats_close(ShmStatsExport *shm) {
+    if (shm->stats) {
+        // Readers that still have it mapped see the emulator go
+        atomic_store_explicit(&shm->stats->state, SHMSTATS_EXITED, memory_order_relaxed);
+        munmap(shm->stats, sizeof(ShmStats));
+        shm_unlink(shm->name);
+    }
+    free(shm->name);
+}
@@ -0,0 +1,71 @@
+#ifndef SHMSTATS_H
+#define SHMSTATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/* Layout of the live metrics published with --stats NAME, read by
+ * invaders-top. This header is self-contained so external tools can include
+ * it as is.
+ *
+ * Readers shm_open(NAME, O_RDONLY), mmap the segment and check `magic`, then
+ * poll the counters. Every counter only grows and is updated once a frame
+ * with relaxed stores, so each one is exact but two loaded together may be a
+ * frame apart. Rates come from the difference between two polls over the
+ * difference in `uptime_ns`. Later versions only append fields, so a reader
+ * takes any version at least as new as its own and no smaller than `size`.
+ */
+#define SHMSTATS_MAGIC 0x54534953       // "SIST"
+#define SHMSTATS_VERSION 1
+#define SHMSTATS_PHASES 8
+#define SHMSTATS_NAME_BYTES 8
+
+typedef enum {
+    SHMSTATS_RUNNING = 1,
+    SHMSTATS_EXITED
+} SHMSTATS_STATE;
+
+typedef struct ShmStats {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;                      // sizeof(ShmStats) in the writer's version
+    uint32_t pid;
+    uint32_t phase_count;
+    char phase_names[SHMSTATS_PHASES][SHMSTATS_NAME_BYTES];
+    atomic_uint state;                  // SHMSTATS_STATE
+
+    atomic_ullong uptime_ns;            // Since the emulator started, as of the last update
+    atomic_ullong frames;
+    atomic_ullong instructions;
+    atomic_ullong cycles;
+    atomic_ullong late_frames;          // Finished after their deadline
+    atomic_ullong skipped_frames;       // Emulated without being drawn
+    atomic_ullong dropped_halves;       // Half frames the render thread never picked up
+    atomic_ullong audio_underruns;      // Audio buffers asked for late
+    atomic_ullong phase_ns[SHMSTATS_PHASES];
+} ShmStats;
+
+typedef struct ShmStatsExport {
+    ShmStats *stats;
+    char *name;
+    uint64_t started;
+} ShmStatsExport;
+
+// What the emulator knows at the end of a frame
+typedef struct StatsSample {
+    uint64_t frames;
+    uint64_t instructions;
+    uint64_t cycles;
+    uint64_t late_frames;
+    uint64_t skipped_frames;
+    uint64_t dropped_halves;
+    uint64_t audio_underruns;
+    const uint64_t *phase_ns;
+} StatsSample;
+
+bool shmstats_open(ShmStatsExport *shm, const char *name, const char *const *phase_names, int phase_count);
+void shmstats_publish(ShmStatsExport *shm, const StatsSample *sample);
+void shmstats_close(ShmStatsExport *shm);
+
+#endif
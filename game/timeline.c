@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "timeline.h"
+
+atomic_bool timeline_on = false;
+
+static uint64_t origin_ns;
+static _Atomic(TimelineThread *) threads = NULL;
+static atomic_int next_tid = 1;
+static _Thread_local TimelineThread *self = NULL;
+static _Thread_local const char *self_name = NULL;
+
+bool timeline_open(void) {
+    origin_ns = pacing_now_ns();
+    atomic_store(&timeline_on, true);
+    return true;
+}
+
+// Names the calling thread's track, before or after its first span
+void timeline_name_thread(const char *name) {
+    self_name = name;
+    if (self) {
+        self->name = name;
+    }
+}
+
+static TimelineChunk *_new_chunk(void) {
+    TimelineChunk *chunk = malloc(sizeof(TimelineChunk));
+    if (chunk) {
+        atomic_init(&chunk->count, 0);
+        atomic_init(&chunk->next, NULL);
+    }
+    return chunk;
+}
+
+// Joins the calling thread to the list the writer walks
+static TimelineThread *_register(void) {
+    TimelineThread *t = malloc(sizeof(TimelineThread));
+    if (!t) {
+        return NULL;
+    }
+
+    t->first = t->last = _new_chunk();
+    if (!t->first) {
+        free(t);
+        return NULL;
+    }
+    t->name = self_name;
+    t->tid = atomic_fetch_add(&next_tid, 1);
+
+    t->next = atomic_load(&threads);
+    while (!atomic_compare_exchange_weak(&threads, &t->next, t)) {
+    }
+    return t;
+}
+
+void timeline_record(const char *name, uint64_t start_ns, uint64_t end_ns, long arg) {
+    if (!self && !(self = _register())) {
+        return;
+    }
+
+    TimelineChunk *chunk = self->last;
+    int count = atomic_load_explicit(&chunk->count, memory_order_relaxed);
+    if (count == TIMELINE_CHUNK_EVENTS) {
+        TimelineChunk *next = _new_chunk();
+        if (!next) {
+            return;                     // Out of memory, the span is lost
+        }
+        atomic_store_explicit(&chunk->next, next, memory_order_release);
+        self->last = chunk = next;
+        count = 0;
+    }
+
+    chunk->events[count] = (TimelineEvent){
+        .name = name,
+        .start_ns = start_ns - origin_ns,
+        .dur_ns = end_ns - start_ns,
+        .arg = arg
+    };
+    atomic_store_explicit(&chunk->count, count + 1, memory_order_release);
+}
+
+// Timestamps are in microseconds, kept to the nanosecond
+bool timeline_write(const char *path) {
+    FILE *file = fopen(path, "w");
+    const char *sep = "";
+
+    if (!file) {
+        return false;
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (TimelineThread *t = atomic_load(&threads); t; t = t->next) {
+        fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                sep, t->tid, t->name ? t->name : "thread");
+        sep = ",\n";
+
+        for (TimelineChunk *c = t->first; c; c = atomic_load_explicit(&c->next, memory_order_acquire)) {
+            int count = atomic_load_explicit(&c->count, memory_order_acquire);
+
+            for (int i = 0; i < count; i++) {
+                const TimelineEvent *e = &c->events[i];
+                fprintf(file, ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%03u,\"dur\":%llu.%03u",
+                        e->name, t->tid,
+                        (unsigned long long)(e->start_ns / 1000), (unsigned)(e->start_ns % 1000),
+                        (unsigned long long)(e->dur_ns / 1000), (unsigned)(e->dur_ns % 1000));
+                if (e->arg >= 0) {
+                    fprintf(file, ",\"args\":{\"n\":%ld}", e->arg);
+                }
+                fprintf(file, "}");
+            }
+        }
+    }
+    fprintf(file, "\n]}\n");
+
+    return fclose(file) == 0;
+}
+
+// Only once every recording thread has stopped
+void timeline_close(void) {
+    atomic_store(&timeline_on, false);
+
+    TimelineThread *t = atomic_exchange(&threads, NULL);
+    while (t) {
+        TimelineThread *next = t->next;
+        TimelineChunk *c = t->first;
+        while (c) {
+            TimelineChunk *next_chunk = atomic_load(&c->next);
+            free(c);
+            c = next_chunk;
+        }
+        free(t);
+        t = next;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "pacing.h"
+
+#define TIMELINE_CHUNK_EVENTS 4096      // Events per allocation of a thread's buffer
+
+/* Spans of host time for Chrome's trace_event format, to open in Perfetto or
+ * chrome://tracing. Each thread records into its own chain of chunks that only
+ * it ever writes, and publishes how far it got with a release store, so
+ * recording takes no locks and the file can be written while threads run.
+ */
+typedef struct TimelineEvent {
+    const char *name;                   // Static string, never copied
+    uint64_t start_ns;
+    uint64_t dur_ns;
+    long arg;                           // Shown as args.n, -1 for none
+} TimelineEvent;
+
+typedef struct TimelineChunk {
+    TimelineEvent events[TIMELINE_CHUNK_EVENTS];
+    atomic_int count;
+    _Atomic(struct TimelineChunk *) next;
+} TimelineChunk;
+
+typedef struct TimelineThread {
+    const char *name;
+    int tid;
+    TimelineChunk *first;
+    TimelineChunk *last;                // Only touched by the owning thread
+    struct TimelineThread *next;
+} TimelineThread;
+
+extern atomic_bool timeline_on;
+
+bool timeline_open(void);
+void timeline_name_thread(const char *name);
+void timeline_record(const char *name, uint64_t start_ns, uint64_t end_ns, long arg);
+bool timeline_write(const char *path);
+void timeline_close(void);
+
+// A span is a timeline_begin() and a timeline_end() on the same thread
+static inline uint64_t timeline_begin(void) {
+    return atomic_load_explicit(&timeline_on, memory_order_relaxed) ? pacing_now_ns() : 0;
+}
+
+static inline void timeline_end(const char *name, uint64_t start_ns) {
+    if (start_ns) {
+        timeline_record(name, start_ns, pacing_now_ns(), -1);
+    }
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "trace.h"
+
+#define CHUNK_BYTES ((size_t)TRACE_CHUNK_RECORDS * sizeof(TraceRecord))
+
+// Moves the file window to the chunk holding the given slot, growing the file to fit
+static bool _map_slot(Tracer *t, uint64_t slot) {
+    uint64_t chunk = slot / TRACE_CHUNK_RECORDS;
+
+    if (t->map && chunk == t->map_chunk) {
+        return true;
+    }
+    if (t->map) {
+        munmap(t->map, CHUNK_BYTES);
+        t->map = NULL;
+    }
+
+    if (ftruncate(t->fd, (off_t)((chunk + 1) * CHUNK_BYTES)) < 0) {
+        return false;
+    }
+    void *map = mmap(NULL, CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, t->fd, (off_t)(chunk * CHUNK_BYTES));
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    t->map = map;
+    t->map_chunk = chunk;
+    return true;
+}
+
+// Slot 0 holds the header, so record n goes in slot n + 1
+static void _write_records(Tracer *t, const TraceRecord *records, size_t count) {
+    while (count && !t->failed) {
+        uint64_t slot = t->written + 1;
+        if (!_map_slot(t, slot)) {
+            fprintf(stderr, "Trace file write failed, the rest of the trace is lost\n");
+            t->failed = true;
+            return;
+        }
+
+        size_t offset = slot % TRACE_CHUNK_RECORDS;
+        size_t n = TRACE_CHUNK_RECORDS - offset < count ? TRACE_CHUNK_RECORDS - offset : count;
+        memcpy(t->map + offset, records, n * sizeof(TraceRecord));
+
+        t->written += n;
+        records += n;
+        count -= n;
+    }
+}
+
+static int _writer_thread(void *data) {
+    Tracer *t = data;
+
+    for (;;) {
+        size_t tail = atomic_load(&t->tail);
+        size_t head = atomic_load_explicit(&t->published, memory_order_acquire);
+
+        if (tail == head) {
+            if (!atomic_load(&t->running)) {
+                break;
+            }
+            SDL_SemWaitTimeout(t->pending, 100);
+            continue;
+        }
+
+        // Up to the end of the ring, the rest goes on the next pass
+        size_t offset = tail & (TRACE_RING_RECORDS - 1);
+        size_t count = head - tail;
+        if (count > TRACE_RING_RECORDS - offset) {
+            count = TRACE_RING_RECORDS - offset;
+        }
+
+        _write_records(t, &t->ring[offset], count);
+        atomic_store(&t->tail, tail + count);
+    }
+
+    return 0;
+}
+
+bool trace_open(Tracer *t, const char *path) {
+    memset(t, 0, sizeof(*t));
+    t->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (t->fd < 0) {
+        return false;
+    }
+
+    TraceHeader header;
+    tracefile_header(&header, 0);
+    t->ring = malloc(TRACE_RING_RECORDS * sizeof(TraceRecord));
+    t->pending = SDL_CreateSemaphore(0);
+    if (!t->ring || !t->pending || pwrite(t->fd, &header, sizeof(header), 0) != sizeof(header)) {
+        trace_close(t);
+        return false;
+    }
+
+    atomic_init(&t->published, 0);
+    atomic_init(&t->tail, 0);
+    atomic_init(&t->running, true);
+    t->writer = SDL_CreateThread(_writer_thread, "trace", t);
+    if (!t->writer) {
+        trace_close(t);
+        return false;
+    }
+    return true;
+}
+
+// The ring is full: hand over what is there and wait for room
+void trace_wait(Tracer *t) {
+    atomic_store_explicit(&t->published, t->head, memory_order_release);
+    SDL_SemPost(t->pending);
+
+    while ((t->tail_seen = atomic_load(&t->tail)) == t->head - TRACE_RING_RECORDS) {
+        t->stalls++;
+        SDL_Delay(1);
+    }
+}
+
+void trace_close(Tracer *t) {
+    if (t->writer) {
+        atomic_store_explicit(&t->published, t->head, memory_order_release);
+        atomic_store(&t->running, false);
+        SDL_SemPost(t->pending);
+        SDL_WaitThread(t->writer, NULL);
+    }
+
+    if (t->map) {
+        munmap(t->map, CHUNK_BYTES);
+    }
+    if (t->fd >= 0) {
+        TraceHeader header;
+        tracefile_header(&header, t->written);
+        if (pwrite(t->fd, &header, sizeof(header), 0) != sizeof(header) ||
+            ftruncate(t->fd, (off_t)((t->written + 1) * sizeof(TraceRecord))) < 0) {
+            fprintf(stderr, "Could not finish the trace file\n");
+        }
+        close(t->fd);
+    }
+    if (t->pending) {
+        SDL_DestroySemaphore(t->pending);
+    }
+    free(t->ring);
+}
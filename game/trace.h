@@ -0,0 +1,58 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
+#include "emu8080.h"
+#include "tracefile.h"
+
+#define TRACE_RING_RECORDS (1 << 16)    // Must be a power of two
+#define TRACE_BATCH 4096                // Records between wake-ups of the writer
+#define TRACE_CHUNK_RECORDS (1 << 20)   // The file is mapped this many slots at a time
+
+/* Records every instruction into a single-producer/single-consumer ring of
+ * fixed-size records, which a writer thread copies into the trace file
+ * through a moving mmap window. Tracing is lossless: when the writer falls
+ * behind, the emulator waits for it. Decode with invaders-tracedump.
+ */
+typedef struct Tracer {
+    int fd;
+    TraceRecord *ring;
+    size_t head;                // The emulator's copy, published below
+    size_t tail_seen;           // Last tail the emulator read, to skip most atomic loads
+    atomic_size_t published;    // Written by the emulator
+    atomic_size_t tail;         // Written by the writer thread
+    SDL_Thread *writer;
+    SDL_sem *pending;
+    atomic_bool running;
+
+    TraceRecord *map;           // Writer's window into the file
+    uint64_t map_chunk;
+    uint64_t written;
+    bool failed;
+
+    unsigned long stalls;       // Times the emulator waited for the writer
+} Tracer;
+
+bool trace_open(Tracer *tracer, const char *path);
+void trace_wait(Tracer *tracer);
+void trace_close(Tracer *tracer);
+
+// Records the instruction the CPU is about to run
+static inline void trace_step(Tracer *t, const State8080 *state) {
+    if (t->head - t->tail_seen == TRACE_RING_RECORDS) {
+        trace_wait(t);
+    }
+
+    tracefile_fill(&t->ring[t->head & (TRACE_RING_RECORDS - 1)], state);
+    t->head++;
+
+    if (!(t->head & (TRACE_BATCH - 1))) {
+        atomic_store_explicit(&t->published, t->head, memory_order_release);
+        SDL_SemPost(t->pending);
+    }
+}
+
+#endif
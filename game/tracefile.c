@@ -0,0 +1,22 @@
+#include <string.h>
+#include "tracefile.h"
+
+void tracefile_header(TraceHeader *header, uint64_t records) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, TRACEFILE_MAGIC, TRACEFILE_MAGIC_BYTES);
+    header->version = TRACEFILE_VERSION;
+    header->record_bytes = sizeof(TraceRecord);
+    header->records = records;
+}
+
+// Reads and checks the header, leaving the file at the first record
+bool tracefile_open(FILE *file, TraceHeader *header) {
+    return fread(header, sizeof(*header), 1, file) == 1 &&
+           memcmp(header->magic, TRACEFILE_MAGIC, TRACEFILE_MAGIC_BYTES) == 0 &&
+           header->version == TRACEFILE_VERSION &&
+           header->record_bytes == sizeof(TraceRecord);
+}
+
+bool tracefile_read(FILE *file, TraceRecord *record) {
+    return fread(record, sizeof(*record), 1, file) == 1;
+}
@@ -0,0 +1,71 @@
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "emu8080.h"
+
+#define TRACEFILE_MAGIC "SITRACE1"
+#define TRACEFILE_MAGIC_BYTES 8
+#define TRACEFILE_VERSION 1
+
+/* Flag bits, laid out as the old text log printed them */
+#define TRACE_INT_ENABLE 0x01
+#define TRACE_CY 0x02
+#define TRACE_P 0x04
+#define TRACE_AC 0x08
+#define TRACE_Z 0x10
+#define TRACE_S 0x20
+#define TRACE_INTERRUPT 0x40    // The opcode is an interrupt's RST, not fetched from pc
+
+/* The CPU as an instruction was about to run. Written in host byte order;
+ * a reader on the other endianness fails the version check. */
+typedef struct TraceRecord {
+    uint64_t cycle;
+    uint16_t pc;
+    uint16_t sp;
+    uint16_t bc;
+    uint16_t de;
+    uint16_t hl;
+    uint8_t a;
+    uint8_t flags;
+    uint8_t opcode;
+    uint8_t operands[MAX_OPERANDS];
+    uint8_t pad;
+} TraceRecord;
+
+// The same size as a record, so the file is an array of record-sized slots
+typedef struct TraceHeader {
+    char magic[TRACEFILE_MAGIC_BYTES];
+    uint32_t version;
+    uint32_t record_bytes;
+    uint64_t records;           // Zero if the emulator did not exit cleanly
+} TraceHeader;
+
+_Static_assert(sizeof(TraceRecord) == 24, "trace record layout");
+_Static_assert(sizeof(TraceHeader) == sizeof(TraceRecord), "trace header slot");
+
+// Inline, since it runs before every traced instruction
+static inline void tracefile_fill(TraceRecord *record, const State8080 *state) {
+    record->cycle = state->cycles;
+    record->pc = state->pc;
+    record->sp = state->sp;
+    record->bc = (state->registers[B] << 8) | state->registers[C];
+    record->de = (state->registers[D] << 8) | state->registers[E];
+    record->hl = (state->registers[H] << 8) | state->registers[L];
+    record->a = state->registers[A];
+    record->flags = (state->cc.z << 4) | (state->cc.s << 5) | (state->cc.p << 2) |
+                    (state->cc.cy << 1) | (state->cc.ac << 3) | state->int_enable |
+                    (state->interrupt >= 0 && state->int_enable ? TRACE_INTERRUPT : 0);
+    record->opcode = NextOpcode8080(state);
+    record->operands[0] = state->memory[(uint16_t)(state->pc + 1)];
+    record->operands[1] = state->memory[(uint16_t)(state->pc + 2)];
+    record->pad = 0;
+}
+
+void tracefile_header(TraceHeader *header, uint64_t records);
+bool tracefile_open(FILE *file, TraceHeader *header);
+bool tracefile_read(FILE *file, TraceRecord *record);
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdlib.h>
+#include <string.h>
+#include "disasm8080.h"
+
+#define DATA_PER_LINE 8
+#define XREFS_PER_LINE 8
+
+static bool _in_image(const Disassembly *dis, uint32_t address) {
+	return address >= dis->start && address < dis->end;
+}
+
+static uint16_t _operand(const Disassembly *dis, uint16_t pc) {
+	return dis->memory[(uint16_t)(pc + 2)] << 8 | dis->memory[(uint16_t)(pc + 1)];
+}
+
+// Undocumented opcodes stop the emulator, so code never runs into them
+static bool _documented(uint8_t opcode) {
+	return opcode_text[opcode][0] != '*';
+}
+
+// Loads, stores and LXI are the instructions with an address operand
+static bool _refers_to_data(uint8_t opcode) {
+	return (opcode & 0xcf) == 0x01 || opcode == 0x22 || opcode == 0x2a || opcode == 0x32 || opcode == 0x3a;
+}
+
+static int _by_target(const void *a, const void *b) {
+	const Xref *x = a;
+	const Xref *y = b;
+	return x->to != y->to ? x->to - y->to : x->from - y->from;
+}
+
+/* Follows every path from the entry points with an explicit stack, marking
+ * what it decodes. The branch rules all come from the opcode table: a
+ * branch with an operand goes there, RST goes to its vector, calls and
+ * conditional branches also fall through, and JMP, RET and PCHL end the path.
+ */
+bool DisassembleImage8080(Disassembly *dis, const uint8_t *memory, uint16_t start, uint32_t length,
+                          const uint16_t *entries, int num_entries) {
+	uint16_t *pending = malloc((length + num_entries) * sizeof(uint16_t));
+	int num_pending = 0;
+
+	memset(dis->marks, 0, sizeof(dis->marks));
+	dis->memory = memory;
+	dis->start = start;
+	dis->end = start + length < MAX_MEM ? start + length : MAX_MEM;
+	dis->num_xrefs = 0;
+	dis->xrefs = malloc(length * sizeof(Xref));
+	if (!pending || !dis->xrefs) {
+		free(pending);
+		free(dis->xrefs);
+		dis->xrefs = NULL;
+		return false;
+	}
+
+	for (int i = 0; i < num_entries; i++) {
+		dis->marks[entries[i]] |= DISASM_CALL;
+		pending[num_pending++] = entries[i];
+	}
+
+	while (num_pending) {
+		uint16_t pc = pending[--num_pending];
+
+		for (;;) {
+			uint8_t opcode = memory[pc];
+			OpcodeInfo info = opcode_info[opcode];
+
+			if (!_in_image(dis, pc) || !_in_image(dis, pc + info.size - 1) ||
+			    (dis->marks[pc] & (DISASM_CODE | DISASM_OPERAND)) || !_documented(opcode)) {
+				break;
+			}
+			dis->marks[pc] |= DISASM_CODE;
+			for (int i = 1; i < info.size; i++) {
+				dis->marks[pc + i] |= DISASM_OPERAND;
+			}
+
+			bool branch = info.kind & OP_BRANCH;
+			bool call = branch && (info.kind & OP_MEM_WRITE);
+			int target = -1;
+
+			if (branch && info.size == 3) {
+				target = _operand(dis, pc);
+			} else if (call) {
+				target = opcode & 0x38;	// RST
+			} else if (_refers_to_data(opcode)) {
+				target = _operand(dis, pc);
+			}
+
+			if (target >= 0) {
+				dis->xrefs[dis->num_xrefs++] = (Xref){ .to = target, .from = pc };
+				if (branch) {
+					dis->marks[target] |= call ? DISASM_CALL : DISASM_JUMP;
+				}
+				if (branch && _in_image(dis, target) && !(dis->marks[target] & DISASM_CODE)) {
+					pending[num_pending++] = target;
+				}
+			}
+
+			if (branch && !call && !(info.kind & OP_CONDITIONAL)) {
+				break;
+			}
+			pc += info.size;
+		}
+	}
+
+	// LXI loads constants as often as pointers. One that lands inside code
+	// is taken for a constant and dropped.
+	int kept = 0;
+	for (int i = 0; i < dis->num_xrefs; i++) {
+		Xref x = dis->xrefs[i];
+		uint8_t opcode = memory[x.from];
+
+		if (_refers_to_data(opcode)) {
+			if ((opcode & 0xcf) == 0x01 && _in_image(dis, x.to) && (dis->marks[x.to] & (DISASM_CODE | DISASM_OPERAND))) {
+				continue;
+			}
+			dis->marks[x.to] |= DISASM_DATA;
+		}
+		dis->xrefs[kept++] = x;
+	}
+	dis->num_xrefs = kept;
+
+	qsort(dis->xrefs, dis->num_xrefs, sizeof(Xref), _by_target);
+	free(pending);
+	return true;
+}
+
+// Names an address that something refers to, subroutines before jump targets before data
+bool Label8080(const Disassembly *dis, uint16_t address, char *buffer, size_t size) {
+	uint8_t marks = dis->marks[address];
+	char prefix = (marks & DISASM_CALL) ? 'S' : (marks & DISASM_JUMP) ? 'L' : (marks & DISASM_DATA) ? 'D' : 0;
+
+	if (!prefix || (marks & DISASM_OPERAND)) {
+		return false;
+	}
+	snprintf(buffer, size, "%c_%04x", prefix, address);
+	return true;
+}
+
+// The references to an address, by address of the referring instruction
+const Xref *Xrefs8080(const Disassembly *dis, uint16_t address, int *count) {
+	int low = 0;
+	int high = dis->num_xrefs;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+		if (dis->xrefs[mid].to < address) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+
+	*count = 0;
+	while (low + *count < dis->num_xrefs && dis->xrefs[low + *count].to == address) {
+		(*count)++;
+	}
+	return *count ? &dis->xrefs[low] : NULL;
+}
+
+// Like Format8080Op, with the label in place of an address operand that has one
+int FormatLabeled8080(const Disassembly *dis, uint16_t pc, char *buffer, size_t size) {
+	uint8_t opcode = dis->memory[pc];
+	const char *text = opcode_text[opcode];
+	const char *operand = strstr(text, "$%04x");
+	char label[DISASM_LABEL_TEXT];
+
+	if (!operand || !Label8080(dis, _operand(dis, pc), label, sizeof(label))) {
+		return Format8080Op(dis->memory, pc, buffer, size);
+	}
+	snprintf(buffer, size, "%.*s%s", (int)(operand - text), text, label);
+	return opcode_info[opcode].size;
+}
+
+static void _print_xrefs(const Disassembly *dis, FILE *out, uint16_t address) {
+	int count;
+	const Xref *refs = Xrefs8080(dis, address, &count);
+
+	for (int i = 0; i < count; i++) {
+		if (i % XREFS_PER_LINE == 0) {
+			fprintf(out, "%s; from", i ? "\n" : "");
+		}
+		fprintf(out, " %04x", refs[i].from);
+	}
+	if (count) {
+		fprintf(out, "\n");
+	}
+}
+
+/* Writes the image from first up to last as an assembler-like listing, with
+ * every label on its own line after the places that refer to it. */
+void PrintDisassembly8080(const Disassembly *dis, FILE *out, uint32_t first, uint32_t last) {
+	uint32_t pc = first < dis->start ? dis->start : first;
+	last = last < dis->end ? last : dis->end - 1;
+
+	// A range can start in the middle of an instruction
+	while (pc > dis->start && (dis->marks[pc] & DISASM_OPERAND)) {
+		pc--;
+	}
+
+	while (pc <= last) {
+		char label[DISASM_LABEL_TEXT];
+		char text[DISASM_TEXT + DISASM_LABEL_TEXT];
+
+		if (Label8080(dis, pc, label, sizeof(label))) {
+			fprintf(out, "\n");
+			_print_xrefs(dis, out, pc);
+			fprintf(out, "%s:\n", label);
+		}
+
+		if (dis->marks[pc] & DISASM_CODE) {
+			int size = FormatLabeled8080(dis, pc, text, sizeof(text));
+			fprintf(out, "    %04x ", pc);
+			// Operands wrap around the top of memory, as Format8080Op reads them
+			for (int i = 0; i < 3; i++) {
+				if (i < size) {
+					fprintf(out, " %02x", dis->memory[(uint16_t)(pc + i)]);
+				} else {
+					fprintf(out, "   ");
+				}
+			}
+			fprintf(out, "   %s\n", text);
+			pc += size;
+			continue;
+		}
+
+		// Data runs until the next line that needs a label or the next code
+		fprintf(out, "    %04x     DB     ", pc);
+		for (int i = 0; i < DATA_PER_LINE && pc <= last; i++, pc++) {
+			fprintf(out, "%s$%02x", i ? "," : "", dis->memory[pc]);
+			if (pc + 1 <= last && ((dis->marks[pc + 1] & DISASM_CODE) || Label8080(dis, pc + 1, label, sizeof(label)))) {
+				pc++;
+				break;
+			}
+		}
+		fprintf(out, "\n");
+	}
+}
+
+void FreeDisassembly8080(Disassembly *dis) {
+	free(dis->xrefs);
+	dis->xrefs = NULL;
+}
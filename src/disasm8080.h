@@ -0,0 +1,50 @@
+#ifndef DISASM8080_H
+#define DISASM8080_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "emu8080.h"
+
+/* What the tracer learned about each byte */
+#define DISASM_CODE    0x01		// First byte of an instruction
+#define DISASM_OPERAND 0x02		// Later byte of an instruction
+#define DISASM_JUMP    0x04		// Jumped to
+#define DISASM_CALL    0x08		// Called, or an entry point
+#define DISASM_DATA    0x10		// Loaded, stored or pointed at with LXI
+
+#define DISASM_LABEL_TEXT 8		// Enough for any Label8080 text
+
+// One reference, from the instruction at `from` to `to`
+typedef struct Xref {
+	uint16_t to;
+	uint16_t from;
+} Xref;
+
+/* A whole ROM image split into code and data by following every jump and
+ * call from its entry points. Bytes no path reaches are taken for data.
+ * References to anywhere in memory are kept sorted by target.
+ */
+typedef struct Disassembly {
+	const uint8_t *memory;
+	uint32_t start;
+	uint32_t end;				// One past the last byte of the image
+	uint8_t marks[MAX_MEM];		// DISASM_ bits
+	Xref *xrefs;
+	int num_xrefs;
+} Disassembly;
+
+bool DisassembleImage8080(Disassembly *dis, const uint8_t *memory, uint16_t start, uint32_t length,
+                          const uint16_t *entries, int num_entries);
+
+bool Label8080(const Disassembly *dis, uint16_t address, char *buffer, size_t size);
+
+const Xref *Xrefs8080(const Disassembly *dis, uint16_t address, int *count);
+
+int FormatLabeled8080(const Disassembly *dis, uint16_t pc, char *buffer, size_t size);
+
+void PrintDisassembly8080(const Disassembly *dis, FILE *out, uint32_t first, uint32_t last);
+
+void FreeDisassembly8080(Disassembly *dis);
+
+#endif
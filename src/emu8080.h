@@ -1,6 +1,7 @@
 #ifndef EMU8080_H
 #define EMU8080_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -9,6 +10,9 @@
 #define MAX_MEM 0x10000
 #define NUM_IO 0xFF
 #define NUM_OPCODES 0x100
+#define PAGE_SHIFT 8
+#define NUM_PAGES (MAX_MEM >> PAGE_SHIFT)
+#define DISASM_TEXT 32			// Enough for any Format8080Op text
 
 
 typedef uint8_t (*input_ptr)(void);
@@ -23,11 +27,42 @@ typedef struct ConditionCodes {
 	uint8_t pad:3;
 } ConditionCodes;
 
+/* Flags an instruction reads or writes */
+#define FLAG_Z  0x01
+#define FLAG_S  0x02
+#define FLAG_P  0x04
+#define FLAG_CY 0x08
+#define FLAG_AC 0x10
+#define FLAG_ALL 0x1f
+
+/* What an instruction does besides registers and flags */
+#define OP_MEM_READ    0x01
+#define OP_MEM_WRITE   0x02
+#define OP_IO          0x04
+#define OP_BRANCH      0x08		// May change pc other than by its size
+#define OP_CONDITIONAL 0x10		// Only when a flag test passes
+
+// Packed into 4 bytes so the whole table is 1KB
+typedef struct OpcodeInfo {
+	unsigned size:2;
+	unsigned cycles:5;
+	unsigned taken_cycles:5;		// Conditional calls and returns take longer when taken
+	unsigned flags_read:5;
+	unsigned flags_written:5;
+	unsigned kind:5;
+} OpcodeInfo;
+
+extern const OpcodeInfo opcode_info[NUM_OPCODES];
+
+// Disassembly printf formats, which take the operand as their only argument
+extern const char *const opcode_text[NUM_OPCODES];
+
 typedef struct State8080 {
 	uint8_t registers[REG_NUMBER];
 	uint16_t sp;
 	uint16_t pc;
 	uint8_t memory[MAX_MEM];
+	uint8_t dirty[NUM_PAGES];		// Pages written since the last snapshot save or restore
 	ConditionCodes cc;
 	uint8_t int_enable:1;
 
@@ -38,6 +73,7 @@ typedef struct State8080 {
 	bool exit;
 
 	unsigned long total_cycles;
+	unsigned long long cycles;		// Never reset, unlike total_cycles
 
 	int interrupt;
 } State8080;
@@ -52,18 +88,61 @@ typedef enum REGISTERS {
     A
 } REGISTERS;
 
+/* Builds with MEMORY_STATS defined count every CPU access to each byte while
+ * memory_stats is set. Other builds compile the counting out entirely. */
+#ifdef MEMORY_STATS
+typedef struct MemoryStats {
+	uint32_t reads[MAX_MEM];
+	uint32_t writes[MAX_MEM];
+	uint32_t fetches[MAX_MEM];		// Opcode and operand bytes
+	uint16_t stack_low;				// Lowest stack pointer seen, other than 0
+} MemoryStats;
+
+extern MemoryStats *memory_stats;
+
+#define COUNT_ACCESS(kind, address) do { if (memory_stats) memory_stats->kind[address]++; } while (0)
+#else
+#define COUNT_ACCESS(kind, address) do { } while (0)
+#endif
+
+// Every CPU data read goes through here so instrumented builds can count it
+static inline uint8_t read_mem(const State8080 *state, uint16_t address) {
+	COUNT_ACCESS(reads, address);
+	return state->memory[address];
+}
+
+// Every CPU write goes through here so snapshots only copy the pages that changed
+static inline void write_mem(State8080 *state, uint16_t address, uint8_t value) {
+	COUNT_ACCESS(writes, address);
+	state->memory[address] = value;
+	state->dirty[address >> PAGE_SHIFT] = 1;
+}
+
+// The opcode the next Emulate8080Op will run, which is an interrupt's RST if one is due
+static inline uint8_t NextOpcode8080(const State8080 *state) {
+	return (state->interrupt >= 0 && state->int_enable) ? state->interrupt : state->memory[state->pc];
+}
+
 void Reset8080(State8080 *state);
 
 void Emulate8080Op(State8080 *state);
 
 void cpu_req_interrupt(State8080 *state, uint8_t opcode);
 
+void SaveState8080(State8080 *state, State8080 *snapshot);
+
+void RestoreState8080(State8080 *state, const State8080 *snapshot);
+
 uint16_t get_reg_pair(State8080 *state, REGISTERS reg1, REGISTERS reg2);
 
+int Format8080Op(const uint8_t *memory, uint16_t pc, char *buffer, size_t size);
+
 int Disassemble8080Op(unsigned char *codebuffer, int pc);
 
 bool LoadRomIntoMemory(State8080 *state, const char *filename, uint16_t offset);
 
-void UnimplimentedInstruction(State8080 *state);
+bool LoadRomFromBuffer(State8080 *state, const uint8_t *data, size_t size, uint16_t offset);
+
+void UnimplimentedInstruction(State8080 *state, uint8_t opcode);
 
 #endif
\ No newline at end of file
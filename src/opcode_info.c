@@ -0,0 +1,15 @@
+#include "emu8080.h"
+
+const OpcodeInfo opcode_info[NUM_OPCODES] = {
+#define OP(code, text, size, cycles, taken_cycles, flags_read, flags_written, kind, exec) \
+	[code] = { size, cycles, taken_cycles, flags_read, flags_written, kind },
+#include "opcodes.def"
+#undef OP
+};
+
+const char *const opcode_text[NUM_OPCODES] = {
+#define OP(code, text, size, cycles, taken_cycles, flags_read, flags_written, kind, exec) \
+	[code] = text,
+#include "opcodes.def"
+#undef OP
+};
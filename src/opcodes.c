@@ -88,7 +88,7 @@ static void _swap(uint8_t *val1, uint8_t *val2) {
 
 //!================================= Arithmetic instructions: =================================//
 
-void ADD_R(State8080 *state, REGISTERS reg) {
+inline void ADD_R(State8080 *state, REGISTERS reg) {
     uint8_t val1 = state->registers[A];
     uint8_t val2 = state->registers[reg];
     uint16_t answer = (uint16_t) val1 + (uint16_t) val2;
@@ -121,19 +121,20 @@ void ADI(State8080 *state, uint8_t value) {
 
 void ADD_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    uint16_t answer = (uint16_t) state->registers[A] + state->memory[offset];
+    uint8_t value = read_mem(state, offset);
+    uint16_t answer = (uint16_t) state->registers[A] + value;
     
     _update_flag_z(state, answer);
     _update_flag_s(state, answer);
     _update_flag_cy_add(state, answer, false);
     _update_flag_p(state, answer);
-    _update_flag_ac_add(state, state->registers[A], state->memory[offset], false);
+    _update_flag_ac_add(state, state->registers[A], value, false);
     state->registers[A] = answer & 0xFF;
 
 }
 
 
-void ADC_R(State8080 *state, REGISTERS reg) {
+inline void ADC_R(State8080 *state, REGISTERS reg) {
     uint8_t val1 = state->registers[A];
     uint8_t val2 = state->registers[reg];
     uint8_t answer = val1 + val2 + state->cc.cy;
@@ -151,7 +152,7 @@ void ADC_R(State8080 *state, REGISTERS reg) {
 void ADC_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
     uint8_t val1 = state->registers[A];
-    uint8_t val2 = state->memory[offset];
+    uint8_t val2 = read_mem(state, offset);
     uint8_t answer = val1 + val2 + state->cc.cy;
 
     _update_flag_z(state, answer);
@@ -181,7 +182,7 @@ void ACI(State8080 *state, uint8_t byte) {
 }
 
 
-void INR_R(State8080 *state, REGISTERS reg) {
+inline void INR_R(State8080 *state, REGISTERS reg) {
     uint16_t answer = state->registers[reg] + 1;
     uint8_t value = state->registers[reg];
     _update_flag_z(state, answer);
@@ -195,7 +196,7 @@ void INR_R(State8080 *state, REGISTERS reg) {
 
 void INR_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    uint8_t value = state->memory[offset];
+    uint8_t value = read_mem(state, offset);
     uint8_t answer = value + 1;
 
     _update_flag_z(state, answer);
@@ -203,12 +204,12 @@ void INR_M(State8080 *state) {
     _update_flag_p(state, answer);
     _update_flag_ac_add(state, value, 1, false);
 
-    state->memory[offset] = answer;
+    write_mem(state, offset, answer);
 
 }
 
 
-void INX_PAIR(State8080 *state, REGISTERS reg) {
+inline void INX_PAIR(State8080 *state, REGISTERS reg) {
     uint16_t pair_value = (state->registers[reg] << 8) | state->registers[reg + 1];
     pair_value++;
     state->registers[reg] = (uint8_t) (pair_value >> 8);
@@ -221,7 +222,7 @@ void INX_SP(State8080 *state) {
 }
 
 
-void SUB_R(State8080 *state, REGISTERS reg) {
+inline void SUB_R(State8080 *state, REGISTERS reg) {
     uint8_t val1 = state->registers[A];
     uint8_t val2 = state->registers[reg];
     uint8_t res = val1 - val2;
@@ -238,7 +239,7 @@ void SUB_R(State8080 *state, REGISTERS reg) {
 void SUB_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
     uint8_t val1 = state->registers[A];
-    uint8_t val2 = state->memory[offset];
+    uint8_t val2 = read_mem(state, offset);
     uint8_t res = val1 - val2;
 
     _update_flag_z(state, res);
@@ -267,7 +268,7 @@ void SUI(State8080 *state, uint8_t byte) {
 }
 
 
-void SBB_R(State8080 *state, REGISTERS reg) {
+inline void SBB_R(State8080 *state, REGISTERS reg) {
     uint8_t val1 = state->registers[A];
     uint8_t val2 = state->registers[reg];
     uint8_t answer = val1 - val2 - state->cc.cy;
@@ -285,7 +286,7 @@ void SBB_R(State8080 *state, REGISTERS reg) {
 void SBB_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
     uint8_t val1 = state->registers[A];
-    uint8_t val2 = state->memory[offset];
+    uint8_t val2 = read_mem(state, offset);
     uint8_t answer = val1 - val2 - state->cc.cy;
 
     _update_flag_z(state, answer);
@@ -314,7 +315,7 @@ void SBI(State8080 *state, uint8_t byte) {
 }
 
 
-void DCR_R(State8080 *state, REGISTERS reg) {
+inline void DCR_R(State8080 *state, REGISTERS reg) {
     uint8_t value = state->registers[reg];
     uint16_t result = state->registers[reg] - 1;
 
@@ -329,7 +330,7 @@ void DCR_R(State8080 *state, REGISTERS reg) {
 
 void DCR_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    uint8_t value = state->memory[offset];
+    uint8_t value = read_mem(state, offset);
     uint8_t answer = value - 1;
 
     _update_flag_z(state, answer);
@@ -337,12 +338,12 @@ void DCR_M(State8080 *state) {
     _update_flag_p(state, answer);
     _update_flag_ac_sub(state, value, 1, false);
 
-    state->memory[offset] -= 1;
+    write_mem(state, offset, answer);
 
 }
 
 
-void DCX_PAIR(State8080 *state, REGISTERS reg) {
+inline void DCX_PAIR(State8080 *state, REGISTERS reg) {
     uint16_t val = get_reg_pair(state, reg, reg + 1) - 1; 
 
     state->registers[reg] = (val >> 8);
@@ -355,7 +356,7 @@ void DCX_SP(State8080 *state) {
 }
 
 
-void DAD_PAIR(State8080 *state, REGISTERS reg) {
+inline void DAD_PAIR(State8080 *state, REGISTERS reg) {
     uint16_t pair_value1 = (state->registers[H] << 8) | state->registers[L];
     uint16_t pair_value2 = (state->registers[reg] << 8) | state->registers[reg + 1];
 
@@ -405,8 +406,8 @@ void DAA(State8080 *state) {
 
 void CALL(State8080* state, uint8_t byte1, uint8_t byte2) {
 
-    state->memory[(uint16_t)(state->sp - 1)] = state->pc >> 8;
-    state->memory[(uint16_t)(state->sp - 2)] = state->pc & 0xFF;
+    write_mem(state, (uint16_t)(state->sp - 1), state->pc >> 8);
+    write_mem(state, (uint16_t)(state->sp - 2), state->pc & 0xFF);
     
     state->sp -= 2;
     state->pc = (byte2 << 8) | byte1;
@@ -414,135 +415,37 @@ void CALL(State8080* state, uint8_t byte1, uint8_t byte2) {
 
 
 
-void CZ(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.z == 1) {
-        CALL(state, byte1, byte2);  
-    }
-}
-
-
-void CNZ(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.z == 0) {
-        CALL(state, byte1, byte2);  
-    }
-}
-
-
-void CC(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.cy == 1) {
-        CALL(state, byte1, byte2);  
-    }
-}
-
-
-void CNC(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.cy == 0) {
-        CALL(state, byte1, byte2);  
-    }
-}
-
-
-void CPO(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.p == 0) {
-        CALL(state, byte1, byte2);  
-    }
-}
-
-
-void CPE(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.p == 1) {
-        CALL(state, byte1, byte2);  
-    }
-}
-
-
-void CP(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.s == 0) {
-        CALL(state, byte1, byte2);  
-    }
-}
-
-
-void CM(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.s == 1) {
-        CALL(state, byte1, byte2);  
-    }
-}
-
-
 void RET(State8080 *state) {
-    state->pc = (state->memory[(uint16_t)(state->sp + 1)] << 8) | state->memory[state->sp];
+    state->pc = (read_mem(state, (uint16_t)(state->sp + 1)) << 8) | read_mem(state, state->sp);
     state->sp += 2; 
 }
 
 
-void RNZ(State8080 *state) {
-    if (state->cc.z == 0) {
-        RET(state);
-    }
+#define DEFINE_CONDITIONAL(cond, test) \
+void J##cond(State8080 *state, uint8_t byte1, uint8_t byte2) { \
+    if (test) { \
+        JMP(state, byte1, byte2); \
+    } \
+} \
+\
+void C##cond(State8080 *state, uint8_t byte1, uint8_t byte2) { \
+    if (test) { \
+        CALL(state, byte1, byte2); \
+    } \
+} \
+\
+void R##cond(State8080 *state) { \
+    if (test) { \
+        RET(state); \
+    } \
 }
 
-
-void RZ(State8080 *state) {
-    if (state->cc.z == 1) {
-        RET(state);
-    }
-}
-
-
-void RNC(State8080 *state) {
-    if (state->cc.cy == 0) {
-        RET(state);
-    }
-}
-
-
-void RC(State8080 *state) {
-    if (state->cc.cy == 1) {
-        RET(state);
-    }
-}
-
-
-void RPO(State8080 *state) {
-    if (state->cc.p == 0) {
-        RET(state);
-    }
-}
-
-
-void RPE(State8080 *state) {
-    if (state->cc.p == 1) {
-        RET(state);
-    }
-}
-
-
-void RP(State8080 *state) {
-    if (state->cc.s == 0) {
-        RET(state);
-    }
-}
-
-
-void RM(State8080 *state) {
-    if (state->cc.s == 1) {
-        RET(state);
-    }
-}
+CONDITIONS(DEFINE_CONDITIONAL)
 
 
 void RST_N(State8080 *state, int n) {
-    state->memory[(uint16_t)(state->sp - 1)] = state->pc >> 8;
-    state->memory[(uint16_t)(state->sp - 2)] = state->pc & 0xFF;
+    write_mem(state, (uint16_t)(state->sp - 1), state->pc >> 8);
+    write_mem(state, (uint16_t)(state->sp - 2), state->pc & 0xFF);
 
     state->sp -= 2;
     state->pc = 8 * n;
@@ -559,72 +462,6 @@ void JMP(State8080 *state, uint8_t byte1, uint8_t byte2) {
 }
 
 
-void JNZ(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.z == 0) {
-        JMP(state, byte1, byte2);
-    }
-}
-
-
-void JZ(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.z == 1) {
-        JMP(state, byte1, byte2);
-    }
-}
-
-
-void JC(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.cy == 1) {
-        JMP(state, byte1, byte2);
-    }
-}
-
-
-void JNC(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.cy == 0) {
-        JMP(state, byte1, byte2);
-    }
-}
-
-
-void JM(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.s == 1) {
-        JMP(state, byte1, byte2);
-    }
-}
-
-
-void JP(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.s == 0) {
-        JMP(state, byte1, byte2);
-    }
-}
-
-
-void JPE(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.p == 1) {
-        JMP(state, byte1, byte2);
-    }
-}
-
-
-void JPO(State8080 *state, uint8_t byte1, uint8_t byte2) {
-
-    if (state->cc.p == 0) {
-        JMP(state, byte1, byte2);
-    }
-}
-
-
-
-
 //!=================================Stack and I/O instructions: =================================//
 
 
@@ -633,16 +470,16 @@ void NOP() {
 }
 
 
-void PUSH(State8080 *state, REGISTERS reg) {  // Use PUSH(state, H) for PUSH M 
-    state->memory[(uint16_t)(state->sp - 1)] = state->registers[reg];
-    state->memory[(uint16_t)(state->sp - 2)] = state->registers[reg + 1];
+inline void PUSH(State8080 *state, REGISTERS reg) {  // Use PUSH(state, H) for PUSH M 
+    write_mem(state, (uint16_t)(state->sp - 1), state->registers[reg]);
+    write_mem(state, (uint16_t)(state->sp - 2), state->registers[reg + 1]);
 
     state->sp -= 2;
 }
 
 
 void PUSH_PSW(State8080 *state) {
-    state->memory[(uint16_t)(state->sp - 1)] = state->registers[A];
+    write_mem(state, (uint16_t)(state->sp - 1), state->registers[A]);
 
     uint8_t psw = (state->cc.s << 7) |
                   (state->cc.z << 6) |
@@ -651,22 +488,22 @@ void PUSH_PSW(State8080 *state) {
                   (1 << 1) |
                   state->cc.cy;
             
-    state->memory[(uint16_t)(state->sp - 2)] = psw;
+    write_mem(state, (uint16_t)(state->sp - 2), psw);
 
     state->sp -= 2;
 } 
 
 
-void POP(State8080 *state, REGISTERS reg) {
-    state->registers[reg + 1] = state->memory[state->sp];
-    state->registers[reg] = state->memory[(uint16_t)(state->sp + 1)];
+inline void POP(State8080 *state, REGISTERS reg) {
+    state->registers[reg + 1] = read_mem(state, state->sp);
+    state->registers[reg] = read_mem(state, (uint16_t)(state->sp + 1));
 
     state->sp += 2;
 }
 
 
 void POP_PSW(State8080 *state) {
-    uint8_t psw = state->memory[state->sp];
+    uint8_t psw = read_mem(state, state->sp);
 
     state->cc.cy = (int8_t)(psw & 1);
     state->cc.p = (int8_t)((psw >> 2) & 1);
@@ -674,15 +511,20 @@ void POP_PSW(State8080 *state) {
     state->cc.z = (int8_t)((psw >> 6) & 1);
     state->cc.s = (int8_t)((psw >> 7) & 1);
 
-    state->registers[A] = state->memory[(uint16_t)(state->sp + 1)];
+    state->registers[A] = read_mem(state, (uint16_t)(state->sp + 1));
 
     state->sp += 2;
 }
 
 
 void XTHL(State8080 *state) {
-    _swap(&state->registers[L], &state->memory[state->sp]);
-    _swap(&state->registers[H], &state->memory[(uint16_t)(state->sp + 1)]);
+    uint8_t l = state->registers[L];
+    uint8_t h = state->registers[H];
+
+    state->registers[L] = read_mem(state, state->sp);
+    state->registers[H] = read_mem(state, (uint16_t)(state->sp + 1));
+    write_mem(state, state->sp, l);
+    write_mem(state, state->sp + 1, h);
 }
 
 
@@ -725,29 +567,29 @@ void XT(State8080 *state) {
 void STA(State8080 *state, uint8_t byte1, uint8_t byte2) {
 
     uint16_t address = ((uint16_t) byte2 << 8) | (byte1);
-    state->memory[address] = state->registers[A];
+    write_mem(state, address, state->registers[A]);
 
 }
 
 
-void MOV_R_R(State8080 *state, REGISTERS reg1, REGISTERS reg2) {
+inline void MOV_R_R(State8080 *state, REGISTERS reg1, REGISTERS reg2) {
     state->registers[reg1] = state->registers[reg2];
 }
 
 
-void MOV_R_M(State8080 *state, REGISTERS reg) {
+inline void MOV_R_M(State8080 *state, REGISTERS reg) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    state->registers[reg] = state->memory[offset];
+    state->registers[reg] = read_mem(state, offset);
 }
 
 
-void MOV_M_R(State8080 *state, REGISTERS reg) {
+inline void MOV_M_R(State8080 *state, REGISTERS reg) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    state->memory[offset] = state->registers[reg];
+    write_mem(state, offset, state->registers[reg]);
 }
 
 
-void MVI_R(State8080 *state, REGISTERS reg, uint8_t byte) {
+inline void MVI_R(State8080 *state, REGISTERS reg, uint8_t byte) {
  
     state->registers[reg] = byte;
 }
@@ -756,11 +598,11 @@ void MVI_R(State8080 *state, REGISTERS reg, uint8_t byte) {
 void MVI_M(State8080 *state, uint8_t byte) {
 
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    state->memory[offset] = byte;
+    write_mem(state, offset, byte);
 }
 
 
-void LXI_PAIR(State8080 *state, REGISTERS reg, uint8_t byte1, uint8_t byte2) {
+inline void LXI_PAIR(State8080 *state, REGISTERS reg, uint8_t byte1, uint8_t byte2) {
 
     _cpu_set_reg_pair(state, reg, reg + 1, byte1, byte2);
 }
@@ -775,35 +617,35 @@ void LXI_SP(State8080 *state, uint8_t byte1, uint8_t byte2) {
 void LDA(State8080 *state, uint8_t byte1, uint8_t byte2) {
 
     uint16_t offset = (byte2 << 8) | byte1;
-    state->registers[A] = state->memory[offset];
+    state->registers[A] = read_mem(state, offset);
 }
 
 
-void LDAX(State8080 *state, REGISTERS reg) {
+inline void LDAX(State8080 *state, REGISTERS reg) {
     uint16_t offset = (state->registers[reg] << 8) | state->registers[reg + 1];
-    state->registers[A] = state->memory[offset];
+    state->registers[A] = read_mem(state, offset);
 }
 
 
 void SHLD(State8080 *state, uint8_t byte1, uint8_t byte2) {
 
     uint16_t offset = (byte2 << 8) | byte1;
-    state->memory[offset] = state->registers[L];
-    state->memory[(uint16_t)(offset + 1)] = state->registers[H];
+    write_mem(state, offset, state->registers[L]);
+    write_mem(state, (uint16_t)(offset + 1), state->registers[H]);
 }
 
 
 void LHLD(State8080 *state, uint8_t byte1, uint8_t byte2) {
 
     uint16_t offset = (byte2 << 8) | byte1;
-    state->registers[H] = state->memory[(uint16_t)(offset + 1)];
-    state->registers[L] = state->memory[offset];
+    state->registers[H] = read_mem(state, (uint16_t)(offset + 1));
+    state->registers[L] = read_mem(state, offset);
 }
 
 
-void STAX(State8080 *state, REGISTERS reg) {
+inline void STAX(State8080 *state, REGISTERS reg) {
     uint16_t offset = (state->registers[reg] << 8) | state->registers[reg + 1];
-    state->memory[offset] = state->registers[A];
+    write_mem(state, offset, state->registers[A]);
 }
 
 
@@ -814,7 +656,7 @@ void XCHG(State8080 *state) {
 
 //!================================= Logical instructions: =================================//
 
-void ANA_R(State8080 *state, REGISTERS reg) {
+inline void ANA_R(State8080 *state, REGISTERS reg) {
     uint8_t val1 = state->registers[A];
     uint8_t val2 = state->registers[reg];
     uint8_t res = val1 & val2;
@@ -828,7 +670,7 @@ void ANA_R(State8080 *state, REGISTERS reg) {
 void ANA_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
     uint8_t val1 = state->registers[A];
-    uint8_t val2 = state->memory[offset];
+    uint8_t val2 = read_mem(state, offset);
     uint8_t res = val1 & val2;
 
     _update_flag_and(state, res, val1, val2);
@@ -847,7 +689,7 @@ void ANI(State8080 *state, uint8_t byte) {
 }
 
 
-void XRA_R(State8080 *state, REGISTERS reg) {
+inline void XRA_R(State8080 *state, REGISTERS reg) {
     uint8_t res = (state->registers[A]) ^ (state->registers[reg]);
     _update_flag_or(state, res);
 
@@ -857,7 +699,7 @@ void XRA_R(State8080 *state, REGISTERS reg) {
 
 void XRA_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    uint8_t res = (state->registers[A]) ^ (state->memory[offset]);
+    uint8_t res = (state->registers[A]) ^ (read_mem(state, offset));
     _update_flag_or(state, res);
 
     state->registers[A] = res;
@@ -873,7 +715,7 @@ void XRI(State8080 *state, uint8_t byte) {
 }
 
 
-void ORA_R(State8080 *state, REGISTERS reg) {
+inline void ORA_R(State8080 *state, REGISTERS reg) {
     uint8_t res = (state->registers[A]) | (state->registers[reg]);
     
     _update_flag_or(state, res);
@@ -884,7 +726,7 @@ void ORA_R(State8080 *state, REGISTERS reg) {
 
 void ORA_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    uint8_t res = (state->registers[A]) | (state->memory[offset]);
+    uint8_t res = (state->registers[A]) | (read_mem(state, offset));
     _update_flag_or(state, res);
 
     state->registers[A] = res;
@@ -901,7 +743,7 @@ void ORI(State8080 *state, uint8_t byte) {
 }
 
 
-void CMP_R(State8080 *state, REGISTERS reg) {
+inline void CMP_R(State8080 *state, REGISTERS reg) {
     uint8_t res = state->registers[A] - state->registers[reg];
     uint8_t val1 = state->registers[A];
     uint8_t val2 = state->registers[reg];
@@ -915,9 +757,9 @@ void CMP_R(State8080 *state, REGISTERS reg) {
 
 void CMP_M(State8080 *state) {
     uint16_t offset = (state->registers[H] << 8) | (state->registers[L]);
-    uint8_t res = state->registers[A] - state->memory[offset];
     uint8_t val1 = state->registers[A];
-    uint8_t val2 = state->memory[offset];
+    uint8_t val2 = read_mem(state, offset);
+    uint8_t res = val1 - val2;
     _update_flag_z(state, res);
     _update_flag_s(state, res);
     _update_flag_p(state, res);
@@ -995,4 +837,107 @@ void RAL(State8080 *state) {
 
     state->cc.cy = msb;
     state->registers[A] = acc_val;
-}
\ No newline at end of file
+}
+
+
+//!================================= Per-register handlers: =================================//
+// The shared handlers they call are marked inline, so each one gets its own
+// copy with the register offset folded in
+
+#define DEFINE_MOV(dst, src) \
+void MOV_##dst##_##src(State8080 *state) { \
+    MOV_R_R(state, dst, src); \
+}
+
+#define DEFINE_PER_REGISTER(reg) \
+void ADD_##reg(State8080 *state) { \
+    ADD_R(state, reg); \
+} \
+\
+void ADC_##reg(State8080 *state) { \
+    ADC_R(state, reg); \
+} \
+\
+void SUB_##reg(State8080 *state) { \
+    SUB_R(state, reg); \
+} \
+\
+void SBB_##reg(State8080 *state) { \
+    SBB_R(state, reg); \
+} \
+\
+void ANA_##reg(State8080 *state) { \
+    ANA_R(state, reg); \
+} \
+\
+void XRA_##reg(State8080 *state) { \
+    XRA_R(state, reg); \
+} \
+\
+void ORA_##reg(State8080 *state) { \
+    ORA_R(state, reg); \
+} \
+\
+void CMP_##reg(State8080 *state) { \
+    CMP_R(state, reg); \
+} \
+\
+void INR_##reg(State8080 *state) { \
+    INR_R(state, reg); \
+} \
+\
+void DCR_##reg(State8080 *state) { \
+    DCR_R(state, reg); \
+} \
+\
+void MVI_##reg(State8080 *state, uint8_t byte) { \
+    MVI_R(state, reg, byte); \
+} \
+\
+void MOV_##reg##_M(State8080 *state) { \
+    MOV_R_M(state, reg); \
+} \
+\
+void MOV_M_##reg(State8080 *state) { \
+    MOV_M_R(state, reg); \
+} \
+\
+REGISTER_LIST_WITH(DEFINE_MOV, reg)
+
+#define DEFINE_PER_PAIR(reg) \
+void INX_##reg(State8080 *state) { \
+    INX_PAIR(state, reg); \
+} \
+\
+void DCX_##reg(State8080 *state) { \
+    DCX_PAIR(state, reg); \
+} \
+\
+void DAD_##reg(State8080 *state) { \
+    DAD_PAIR(state, reg); \
+} \
+\
+void PUSH_##reg(State8080 *state) { \
+    PUSH(state, reg); \
+} \
+\
+void POP_##reg(State8080 *state) { \
+    POP(state, reg); \
+} \
+\
+void LXI_##reg(State8080 *state, uint8_t byte1, uint8_t byte2) { \
+    LXI_PAIR(state, reg, byte1, byte2); \
+}
+
+#define DEFINE_PER_INDIRECT_PAIR(reg) \
+void LDAX_##reg(State8080 *state) { \
+    LDAX(state, reg); \
+} \
+\
+void STAX_##reg(State8080 *state) { \
+    STAX(state, reg); \
+}
+
+REGISTER_LIST(DEFINE_PER_REGISTER)
+PAIR_LIST(DEFINE_PER_PAIR)
+INDIRECT_PAIR_LIST(DEFINE_PER_INDIRECT_PAIR)
@@ -53,64 +53,35 @@ void DAD_SP(State8080 *state);
 
 void DAA(State8080 *state);
 //================================= Branch instructions: =================================//
-void CALL(State8080* state, uint8_t byte1, uint8_t byte2);
-
-void CZ(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void CNZ(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void CC(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void CNC(State8080 *state, uint8_t byte1, uint8_t byte2); 
-
-void CPO(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void CPE(State8080 *state, uint8_t byte1, uint8_t byte2);
+/* Condition codes in the order bits 3-5 of Jcc, Ccc and Rcc encode them. The
+ * conditional jump, call and return for each are generated from this list. */
+#define CONDITIONS(X) \
+    X(NZ, state->cc.z == 0) \
+    X(Z,  state->cc.z == 1) \
+    X(NC, state->cc.cy == 0) \
+    X(C,  state->cc.cy == 1) \
+    X(PO, state->cc.p == 0) \
+    X(PE, state->cc.p == 1) \
+    X(P,  state->cc.s == 0) \
+    X(M,  state->cc.s == 1)
+
+#define DECLARE_CONDITIONAL(cond, test) \
+    void J##cond(State8080 *state, uint8_t byte1, uint8_t byte2); \
+    void C##cond(State8080 *state, uint8_t byte1, uint8_t byte2); \
+    void R##cond(State8080 *state);
+
+CONDITIONS(DECLARE_CONDITIONAL)
 
-void CP(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void CM(State8080 *state, uint8_t byte1, uint8_t byte2);
+void CALL(State8080* state, uint8_t byte1, uint8_t byte2);
 
 void RET(State8080 *state);
 
-void RNZ(State8080 *state);
-
-void RZ(State8080 *state);
-
-void RNC(State8080 *state);
-
-void RC(State8080 *state);
-
-void RPO(State8080 *state);
-
-void RPE(State8080 *state);
-
-void RP(State8080 *state);
-
-void RM(State8080 *state);
-
 void RST_N(State8080 *state, int n);
 
 void PCHL(State8080 *state);
 
 void JMP(State8080 *state, uint8_t byte1, uint8_t byte2);
 
-void JNZ(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void JZ(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void JC(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void JNC(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void JM(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void JP(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void JPE(State8080 *state, uint8_t byte1, uint8_t byte2);
-
-void JPO(State8080 *state, uint8_t byte1, uint8_t byte2);
-
 //=================================Stack and I/O instructions: =================================//
 void NOP();
 
@@ -207,4 +178,49 @@ void RAR(State8080 *state);
 
 void RAL(State8080 *state);
 
+//================================= Per-register handlers: =================================//
+/* Registers in the order bits 0-2 and 3-5 of an opcode encode them, without
+ * M, and register pairs by their high register. A handler is generated for
+ * each register and pair from these lists, with the register fixed inside it,
+ * so the dispatch passes no register numbers at run time. */
+#define REGISTER_LIST(X) X(B) X(C) X(D) X(E) X(H) X(L) X(A)
+#define REGISTER_LIST_WITH(X, arg) X(arg, B) X(arg, C) X(arg, D) X(arg, E) X(arg, H) X(arg, L) X(arg, A)
+#define PAIR_LIST(X) X(B) X(D) X(H)
+#define INDIRECT_PAIR_LIST(X) X(B) X(D)     // The pairs LDAX and STAX take
+
+#define DECLARE_MOV(dst, src) \
+    void MOV_##dst##_##src(State8080 *state);
+
+#define DECLARE_PER_REGISTER(reg) \
+    void ADD_##reg(State8080 *state); \
+    void ADC_##reg(State8080 *state); \
+    void SUB_##reg(State8080 *state); \
+    void SBB_##reg(State8080 *state); \
+    void ANA_##reg(State8080 *state); \
+    void XRA_##reg(State8080 *state); \
+    void ORA_##reg(State8080 *state); \
+    void CMP_##reg(State8080 *state); \
+    void INR_##reg(State8080 *state); \
+    void DCR_##reg(State8080 *state); \
+    void MVI_##reg(State8080 *state, uint8_t byte); \
+    void MOV_##reg##_M(State8080 *state); \
+    void MOV_M_##reg(State8080 *state); \
+    REGISTER_LIST_WITH(DECLARE_MOV, reg)
+
+#define DECLARE_PER_PAIR(reg) \
+    void INX_##reg(State8080 *state); \
+    void DCX_##reg(State8080 *state); \
+    void DAD_##reg(State8080 *state); \
+    void PUSH_##reg(State8080 *state); \
+    void POP_##reg(State8080 *state); \
+    void LXI_##reg(State8080 *state, uint8_t byte1, uint8_t byte2);
+
+#define DECLARE_PER_INDIRECT_PAIR(reg) \
+    void LDAX_##reg(State8080 *state); \
+    void STAX_##reg(State8080 *state);
+
+REGISTER_LIST(DECLARE_PER_REGISTER)
+PAIR_LIST(DECLARE_PER_PAIR)
+INDIRECT_PAIR_LIST(DECLARE_PER_INDIRECT_PAIR)
+
 #endif
\ No newline at end of file
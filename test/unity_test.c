@@ -1,8 +1,10 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "unity.h"
 #include "emu8080.h"
 #include "opcodes.h"
+#include "disasm8080.h"
 
 State8080 *cpu;
 
@@ -53,9 +55,9 @@ void test_DCR_M(void) {
 }
 
 
-void test_ADD_I(void) {
+void test_ADI(void) {
     cpu->registers[A] = 0x25;
-    ADD_I(cpu, 0x03);
+    ADI(cpu, 0x03);
 
     TEST_ASSERT_EQUAL_HEX8(0x28, cpu->registers[A]);
     TEST_ASSERT_BITS(1, 0, cpu->cc.z);
@@ -112,7 +114,7 @@ void test_MVI_R(void) {
 }
 
 void test_LXI_PAIR(void) {
-    LXI_PAIR(cpu, B, C, 0x26, 0x11);
+    LXI_PAIR(cpu, B, 0x26, 0x11);
 
     TEST_ASSERT_EQUAL_HEX8(0x26, cpu->registers[C]);
     TEST_ASSERT_EQUAL_HEX8(0x11, cpu->registers[B]);
@@ -124,6 +126,159 @@ void test_LXI_SP(void) {
     TEST_ASSERT_EQUAL_HEX16(0xFE15, cpu->sp);
 }
 
+// SHLD used to fall through into INX H
+void test_SHLD(void) {
+    cpu->registers[H] = 0x12;
+    cpu->registers[L] = 0x34;
+    cpu->memory[0x0000] = 0x22;
+    cpu->memory[0x0001] = 0x00;
+    cpu->memory[0x0002] = 0x24;
+
+    Emulate8080Op(cpu);
+
+    TEST_ASSERT_EQUAL_HEX8(0x34, cpu->memory[0x2400]);
+    TEST_ASSERT_EQUAL_HEX8(0x12, cpu->memory[0x2401]);
+    TEST_ASSERT_EQUAL_HEX16(0x1234, get_reg_pair(cpu, H, L));
+    TEST_ASSERT_EQUAL_HEX16(0x0003, cpu->pc);
+}
+
+// 0x1d used to be skipped
+void test_DCR_E(void) {
+    cpu->registers[E] = 0x01;
+    cpu->memory[0x0000] = 0x1d;
+
+    Emulate8080Op(cpu);
+
+    TEST_ASSERT_EQUAL_HEX8(0x00, cpu->registers[E]);
+    TEST_ASSERT_BITS(1, 1, cpu->cc.z);
+    TEST_ASSERT_EQUAL_HEX16(0x0001, cpu->pc);
+}
+
+void test_SaveState8080(void) {
+    State8080 *snapshot = malloc(sizeof(State8080));
+    if (snapshot == NULL) {
+        TEST_FAIL_MESSAGE("Failed to allocate memory for the snapshot\n");
+    }
+
+    cpu->memory[0x2000] = 0x11;
+    cpu->registers[A] = 0x22;
+    SaveState8080(cpu, snapshot);
+
+    // Only pages written through write_mem since the save are copied back
+    write_mem(cpu, 0x2000, 0x33);
+    cpu->memory[0x3000] = 0x44;
+    cpu->registers[A] = 0x55;
+    RestoreState8080(cpu, snapshot);
+
+    TEST_ASSERT_EQUAL_HEX8(0x11, cpu->memory[0x2000]);
+    TEST_ASSERT_EQUAL_HEX8(0x44, cpu->memory[0x3000]);
+    TEST_ASSERT_EQUAL_HEX8(0x22, cpu->registers[A]);
+
+    // Restoring clears the marks, so the next save is cheap again
+    write_mem(cpu, 0x3000, 0x66);
+    SaveState8080(cpu, snapshot);
+    TEST_ASSERT_EQUAL_HEX8(0x66, snapshot->memory[0x3000]);
+    TEST_ASSERT_EQUAL_HEX8(0x11, snapshot->memory[0x2000]);
+
+    free(snapshot);
+}
+
+void test_CNZ_cycles(void) {
+    cpu->sp = 0x2400;
+    cpu->memory[0x0000] = 0xc4;
+    cpu->memory[0x0001] = 0x00;
+    cpu->memory[0x0002] = 0x10;
+    cpu->memory[0x0003] = 0xc4;
+    cpu->memory[0x0004] = 0x00;
+    cpu->memory[0x0005] = 0x10;
+
+    cpu->cc.z = 1;
+    Emulate8080Op(cpu);
+    TEST_ASSERT_EQUAL_INT(11, cpu->cycles);
+    TEST_ASSERT_EQUAL_HEX16(0x0003, cpu->pc);
+
+    cpu->cc.z = 0;
+    Emulate8080Op(cpu);
+    TEST_ASSERT_EQUAL_INT(11 + 17, cpu->cycles);
+    TEST_ASSERT_EQUAL_HEX16(0x1000, cpu->pc);
+    TEST_ASSERT_EQUAL_HEX16(0x23FE, cpu->sp);
+}
+
+void test_RNZ_cycles(void) {
+    cpu->sp = 0x23FE;
+    cpu->memory[0x23FE] = 0x00;
+    cpu->memory[0x23FF] = 0x10;
+    cpu->memory[0x0000] = 0xc0;
+    cpu->memory[0x0001] = 0xc0;
+
+    cpu->cc.z = 1;
+    Emulate8080Op(cpu);
+    TEST_ASSERT_EQUAL_INT(5, cpu->cycles);
+    TEST_ASSERT_EQUAL_HEX16(0x0001, cpu->pc);
+
+    cpu->cc.z = 0;
+    Emulate8080Op(cpu);
+    TEST_ASSERT_EQUAL_INT(5 + 11, cpu->cycles);
+    TEST_ASSERT_EQUAL_HEX16(0x1000, cpu->pc);
+    TEST_ASSERT_EQUAL_HEX16(0x2400, cpu->sp);
+}
+
+void test_Format8080Op(void) {
+    char text[DISASM_TEXT];
+
+    cpu->memory[0x0000] = 0xc3;
+    cpu->memory[0x0001] = 0x34;
+    cpu->memory[0x0002] = 0x12;
+    TEST_ASSERT_EQUAL_INT(3, Format8080Op(cpu->memory, 0x0000, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("JMP    $1234", text);
+
+    // Operands wrap around the top of memory
+    cpu->memory[0xFFFF] = 0x3e;
+    cpu->memory[0x0000] = 0x07;
+    TEST_ASSERT_EQUAL_INT(2, Format8080Op(cpu->memory, 0xFFFF, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("MVI    A,#$07", text);
+}
+
+void test_DisassembleImage8080(void) {
+    static const uint8_t image[] = {
+        0xcd, 0x08, 0x00,       // 0000 CALL 0008
+        0xc3, 0x03, 0x00,       // 0003 JMP 0003
+        0x00, 0x00,             // 0006 never reached
+        0x3a, 0x0c, 0x00,       // 0008 LDA 000c
+        0xc9,                   // 000b RET
+        0x42                    // 000c
+    };
+    Disassembly dis;
+    uint16_t entry = 0x0000;
+    char label[DISASM_LABEL_TEXT];
+    char text[DISASM_TEXT];
+    int count;
+
+    memcpy(cpu->memory, image, sizeof(image));
+    TEST_ASSERT_TRUE(DisassembleImage8080(&dis, cpu->memory, 0x0000, sizeof(image), &entry, 1));
+
+    TEST_ASSERT_TRUE(dis.marks[0x0000] & DISASM_CODE);
+    TEST_ASSERT_TRUE(dis.marks[0x0001] & DISASM_OPERAND);
+    TEST_ASSERT_FALSE(dis.marks[0x0006] & DISASM_CODE);
+    TEST_ASSERT_TRUE(dis.marks[0x000b] & DISASM_CODE);
+    TEST_ASSERT_TRUE(dis.marks[0x000c] & DISASM_DATA);
+
+    TEST_ASSERT_TRUE(Label8080(&dis, 0x0008, label, sizeof(label)));
+    TEST_ASSERT_EQUAL_STRING("S_0008", label);
+    TEST_ASSERT_TRUE(Label8080(&dis, 0x0003, label, sizeof(label)));
+    TEST_ASSERT_EQUAL_STRING("L_0003", label);
+    TEST_ASSERT_FALSE(Label8080(&dis, 0x0009, label, sizeof(label)));
+
+    const Xref *refs = Xrefs8080(&dis, 0x000c, &count);
+    TEST_ASSERT_EQUAL_INT(1, count);
+    TEST_ASSERT_EQUAL_HEX16(0x0008, refs[0].from);
+
+    TEST_ASSERT_EQUAL_INT(3, FormatLabeled8080(&dis, 0x0000, text, sizeof(text)));
+    TEST_ASSERT_EQUAL_STRING("CALL   S_0008", text);
+
+    FreeDisassembly8080(&dis);
+}
+
 #ifdef TESTING
 
 int main(void) {
@@ -131,13 +286,20 @@ int main(void) {
     RUN_TEST(test_STA);
     RUN_TEST(test_DCR_R);
     RUN_TEST(test_DCR_M);
-    RUN_TEST(test_ADD_I);
+    RUN_TEST(test_ADI);
     RUN_TEST(test_ADD_R);
     RUN_TEST(test_ADD_M);
     RUN_TEST(test_JMP);
     RUN_TEST(test_MVI_R);
     RUN_TEST(test_LXI_PAIR);
     RUN_TEST(test_LXI_SP);
+    RUN_TEST(test_SHLD);
+    RUN_TEST(test_DCR_E);
+    RUN_TEST(test_SaveState8080);
+    RUN_TEST(test_CNZ_cycles);
+    RUN_TEST(test_RNZ_cycles);
+    RUN_TEST(test_Format8080Op);
+    RUN_TEST(test_DisassembleImage8080);
     return UNITY_END();
 }
 #endif
\ No newline at end of file
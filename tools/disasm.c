@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "emu8080.h"
+#include "disasm8080.h"
+
+#define ROM_SIZE 0x2000
+#define RAM_END 0x4000
+#define MAX_ENTRIES 64
+
+// Reset, and the RST 1 and RST 2 the video hardware raises every frame
+static const uint16_t default_entries[] = { 0x0000, 0x0008, 0x0010 };
+#define NUM_DEFAULT_ENTRIES (int)(sizeof(default_entries) / sizeof(default_entries[0]))
+
+static const char *const roms[] = { "invaders.h", "invaders.g", "invaders.f", "invaders.e" };
+
+// Lists the Space Invaders ROM with labels and cross-references
+int main(int argc, char **argv) {
+    static State8080 state;
+    const char *dir = argc > 1 ? argv[1] : "../roms";
+    char path[512];
+    uint16_t entries[MAX_ENTRIES];
+    int num_entries = NUM_DEFAULT_ENTRIES;
+
+    // Code only reached through PCHL or tables can be given as more entry points
+    memcpy(entries, default_entries, sizeof(default_entries));
+    for (int i = 2; i < argc; i++) {
+        char *end;
+        unsigned long entry = strtoul(argv[i], &end, 16);
+        if (!*argv[i] || *end || entry >= ROM_SIZE || num_entries == MAX_ENTRIES) {
+            fprintf(stderr, "Usage: %s [ROM_DIR [ENTRY...]], entries in hex\n", argv[0]);
+            return 2;
+        }
+        entries[num_entries++] = entry;
+    }
+
+    Reset8080(&state);
+    for (int i = 0; i < 4; i++) {
+        snprintf(path, sizeof(path), "%s/%s", dir, roms[i]);
+        if (!LoadRomIntoMemory(&state, path, i * 0x800)) {
+            fprintf(stderr, "Could not open %s\n", path);
+            return 1;
+        }
+    }
+
+    static Disassembly dis;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (!DisassembleImage8080(&dis, state.memory, 0, ROM_SIZE, entries, num_entries)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    PrintDisassembly8080(&dis, stdout, 0, ROM_SIZE - 1);
+
+    // Variables are only ever referred to, never listed
+    printf("\n; RAM\n");
+    for (int i = 0; i < dis.num_xrefs; i++) {
+        const Xref *x = &dis.xrefs[i];
+        if (x->to >= ROM_SIZE && x->to < RAM_END && (i == 0 || dis.xrefs[i - 1].to != x->to)) {
+            int count;
+            const Xref *refs = Xrefs8080(&dis, x->to, &count);
+
+            printf("; %04x from", x->to);
+            for (int j = 0; j < count; j++) {
+                printf(" %04x", refs[j].from);
+            }
+            printf("\n");
+        }
+    }
+
+    int code = 0, labels = 0;
+    for (int a = 0; a < ROM_SIZE; a++) {
+        char label[DISASM_LABEL_TEXT];
+        code += (dis.marks[a] & (DISASM_CODE | DISASM_OPERAND)) != 0;
+        labels += Label8080(&dis, a, label, sizeof(label));
+    }
+    fprintf(stderr, "%d bytes of code, %d of data, %d labels, %d references, traced in %.2f ms\n",
+            code, ROM_SIZE - code, labels, dis.num_xrefs,
+            (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+    FreeDisassembly8080(&dis);
+    return 0;
+}
@@ -0,0 +1,53 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "framehash.h"
+
+// Reports the first frame where two --hash-log files disagree
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s LOG_A LOG_B\n", argv[0]);
+        return 2;
+    }
+
+    FILE *a = fopen(argv[1], "rb");
+    FILE *b = fopen(argv[2], "rb");
+    if (!a || !b) {
+        fprintf(stderr, "Could not open %s\n", !a ? argv[1] : argv[2]);
+        return 2;
+    }
+    bool valid_a = hashlog_open(a);
+    bool valid_b = hashlog_open(b);
+    if (!valid_a || !valid_b) {
+        fprintf(stderr, "Not a hash log: %s\n", !valid_a ? argv[1] : argv[2]);
+        return 2;
+    }
+
+    FrameHash ra, rb;
+    unsigned long frames = 0;
+
+    for (;;) {
+        bool has_a = hashlog_read(a, &ra);
+        bool has_b = hashlog_read(b, &rb);
+
+        if (!has_a || !has_b) {
+            if (has_a != has_b) {
+                printf("Logs agree for %lu frames, then %s ends\n", frames, has_a ? argv[2] : argv[1]);
+                return 1;
+            }
+            break;
+        }
+
+        if (ra.vram != rb.vram || ra.ram != rb.ram) {
+            printf("Logs diverge at frame %" PRIu32 ":%s%s\n", ra.frame,
+                   ra.vram != rb.vram ? " vram" : "",
+                   ra.ram != rb.ram ? " ram" : "");
+            printf("  %s: vram %016" PRIx64 " ram %016" PRIx64 "\n", argv[1], ra.vram, ra.ram);
+            printf("  %s: vram %016" PRIx64 " ram %016" PRIx64 "\n", argv[2], rb.vram, rb.ram);
+            return 1;
+        }
+        frames++;
+    }
+
+    printf("Logs identical for %lu frames\n", frames);
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shmstats.h"
+
+typedef struct Snapshot {
+    uint64_t uptime_ns;
+    uint64_t frames;
+    uint64_t instructions;
+    uint64_t late_frames;
+    uint64_t skipped_frames;
+    uint64_t dropped_halves;
+    uint64_t audio_underruns;
+    uint64_t phase_ns[SHMSTATS_PHASES];
+} Snapshot;
+
+static void _load(const ShmStats *s, Snapshot *snap) {
+    snap->uptime_ns = atomic_load_explicit(&s->uptime_ns, memory_order_relaxed);
+    snap->frames = atomic_load_explicit(&s->frames, memory_order_relaxed);
+    snap->instructions = atomic_load_explicit(&s->instructions, memory_order_relaxed);
+    snap->late_frames = atomic_load_explicit(&s->late_frames, memory_order_relaxed);
+    snap->skipped_frames = atomic_load_explicit(&s->skipped_frames, memory_order_relaxed);
+    snap->dropped_halves = atomic_load_explicit(&s->dropped_halves, memory_order_relaxed);
+    snap->audio_underruns = atomic_load_explicit(&s->audio_underruns, memory_order_relaxed);
+    for (uint32_t i = 0; i < s->phase_count; i++) {
+        snap->phase_ns[i] = atomic_load_explicit(&s->phase_ns[i], memory_order_relaxed);
+    }
+}
+
+static void _show(const ShmStats *s, const Snapshot *a, const Snapshot *b, bool tty) {
+    double seconds = (b->uptime_ns - a->uptime_ns) / 1e9;
+    unsigned long up = b->uptime_ns / 1000000000ULL;
+
+    if (tty) {
+        printf("\033[H\033[J");
+    }
+    printf("invaders pid %u, up %lu:%02lu:%02lu\n", s->pid, up / 3600, up / 60 % 60, up % 60);
+    if (seconds <= 0) {
+        printf("  no frames in the last interval\n\n");
+        return;
+    }
+
+    printf("  %.2f MIPS, %.1f fps, %llu frames\n",
+           (b->instructions - a->instructions) / seconds / 1e6, (b->frames - a->frames) / seconds,
+           (unsigned long long)b->frames);
+    printf("  late %llu (+%llu), undrawn %llu (+%llu), dropped halves %llu (+%llu), audio underruns %llu (+%llu)\n",
+           (unsigned long long)b->late_frames, (unsigned long long)(b->late_frames - a->late_frames),
+           (unsigned long long)b->skipped_frames, (unsigned long long)(b->skipped_frames - a->skipped_frames),
+           (unsigned long long)b->dropped_halves, (unsigned long long)(b->dropped_halves - a->dropped_halves),
+           (unsigned long long)b->audio_underruns, (unsigned long long)(b->audio_underruns - a->audio_underruns));
+    printf("  host time:");
+    for (uint32_t i = 0; i < s->phase_count; i++) {
+        printf(" %.*s %.1f%%", SHMSTATS_NAME_BYTES, s->phase_names[i],
+               (b->phase_ns[i] - a->phase_ns[i]) / (seconds * 1e7));
+    }
+    printf("\n\n");
+    fflush(stdout);
+}
+
+// Shows the --stats of a running emulator until it exits
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s NAME [SECONDS]\n", argv[0]);
+        return 2;
+    }
+
+    double interval = argc == 3 ? atof(argv[2]) : 1;
+    if (interval <= 0) {
+        fprintf(stderr, "Invalid interval: %s\n", argv[2]);
+        return 2;
+    }
+
+    char name[256];
+    snprintf(name, sizeof(name), "%s%s", argv[1][0] == '/' ? "" : "/", argv[1]);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "No emulator is publishing %s\n", name);
+        return 1;
+    }
+
+    // The emulator creates the segment before it sizes it, and reading past the end would fault
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmStats)) {
+        fprintf(stderr, "Not a compatible metrics segment: %s\n", name);
+        close(fd);
+        return 1;
+    }
+
+    void *map = mmap(NULL, sizeof(ShmStats), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    const ShmStats *s = map;
+    if (map == MAP_FAILED || s->magic != SHMSTATS_MAGIC ||
+        s->version < SHMSTATS_VERSION || s->size < sizeof(ShmStats) || s->phase_count > SHMSTATS_PHASES) {
+        fprintf(stderr, "Not a compatible metrics segment: %s\n", name);
+        return 1;
+    }
+    atomic_thread_fence(memory_order_acquire);
+
+    bool tty = isatty(STDOUT_FILENO);
+    struct timespec wait = { (time_t)interval, (long)((interval - (time_t)interval) * 1e9) };
+    Snapshot prev, now;
+
+    _load(s, &prev);
+    while (atomic_load_explicit(&s->state, memory_order_relaxed) == SHMSTATS_RUNNING) {
+        nanosleep(&wait, NULL);
+        // A crashed emulator never marks the segment as exited
+        if (kill(s->pid, 0) != 0 && errno == ESRCH) {
+            printf("Emulator is gone\n");
+            munmap(map, sizeof(ShmStats));
+            return 1;
+        }
+        _load(s, &now);
+        _show(s, &prev, &now, tty);
+        prev = now;
+    }
+
+    printf("Emulator exited\n");
+    munmap(map, sizeof(ShmStats));
+    return 0;
+}
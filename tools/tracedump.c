@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "tracefile.h"
+
+// Prints a --trace file as the text instruction log, optionally only part of it
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 4) {
+        fprintf(stderr, "Usage: %s TRACE [FIRST [COUNT]]\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (!file) {
+        fprintf(stderr, "Could not open %s\n", argv[1]);
+        return 2;
+    }
+
+    TraceHeader header;
+    if (!tracefile_open(file, &header)) {
+        fprintf(stderr, "Not a trace file: %s\n", argv[1]);
+        return 2;
+    }
+
+    unsigned long first = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+    unsigned long count = argc > 3 ? strtoul(argv[3], NULL, 10) : (unsigned long)-1;
+    first = first ? first : 1;
+
+    // A trace from a run that did not exit cleanly has no count, and ends in unused slots
+    if (!header.records) {
+        fprintf(stderr, "Trace was not closed, it may end in empty records\n");
+    }
+
+    // Record n is in slot n, after the header
+    if (fseek(file, (long)(first * sizeof(TraceRecord)), SEEK_SET) != 0) {
+        return 0;
+    }
+
+    TraceRecord r;
+    for (unsigned long n = first; count && (!header.records || n <= header.records) && tracefile_read(file, &r); n++) {
+        printf("%lu\t%02x  A: %02x, BC: %04x, DE: %04x, HL: %04x, pc: %04x, sp: %04x, flags: %04x\n",
+               n, r.opcode, r.a, r.bc, r.de, r.hl, r.pc, r.sp, r.flags & ~TRACE_INTERRUPT);
+        count--;
+    }
+
+    fclose(file);
+    return 0;
+}